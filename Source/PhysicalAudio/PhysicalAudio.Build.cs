@@ -37,6 +37,7 @@ public class PhysicalAudio : ModuleRules
 			{
 				"CoreUObject",
 				"Engine",
+				"Json",
 				"Slate",
 				"SlateCore",
 				// ... add private dependencies that you statically link with here ...	
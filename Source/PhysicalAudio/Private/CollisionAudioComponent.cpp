@@ -2,7 +2,12 @@
 
 #include "PhysicalAudio.h"
 #include "CollisionAudioComponent.h"
-#include "Kismet/DataTableFunctionLibrary.h"
+#include "PhysicalAudioSubsystem.h"
+#include "PhysicalAudioPresetRegistry.h"
+#include "PhysicalAudioStats.h"
+#include "PhysicalAudioTrace.h"
+#include "PhysicalAudioCapture.h"
+#include "PhysicalAudioCore.h"
 #include "Components/PrimitiveComponent.h"
 #include "Kismet/KismetSystemLibrary.h"
 #include "Kismet/KismetMathLibrary.h"
@@ -21,6 +26,11 @@ UCollisionAudioComponent::UCollisionAudioComponent()
 	bFirstHit = true;
 	bIsHeavyHit = false;
 	bDisableDeltaThreshold = false;
+	bCoalesceImpacts = false;
+	bRouteHitsThroughSubsystem = false;
+	bCollisionEventBound = false;
+	bHitsRouted = false;
+	ImpactAudioData = nullptr;
 
 	LastInvalidHitGameTime = 0.f;
 	LastTriggerGameTime = 0.f;
@@ -28,6 +38,8 @@ UCollisionAudioComponent::UCollisionAudioComponent()
 
 	TriggerLocationDeltaThreshold = 25.f;
 	TriggerRotationDeltaThreshold = 90.f;
+
+	Subsystem = nullptr;
 }
 
 
@@ -36,15 +48,36 @@ void UCollisionAudioComponent::BeginPlay()
 {
 	Super::BeginPlay();
 
+	Subsystem = UPhysicalAudioSubsystem::Get(GetWorld());
+
 	Initialize();
 }
 
+void UCollisionAudioComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (bHitsRouted && Subsystem)
+	{
+		Subsystem->UnregisterImpactRoutes(this);
+		bHitsRouted = false;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 
 void UCollisionAudioComponent::Initialize()
 {
-	if (UDataTableFunctionLibrary::Generic_GetDataTableRowFromName(DataTableAsset, ImpactNameRef, &ImpactAudioData))
+	// Shared with every component on the same row, a missing row keeps the previous one
+	TSharedPtr<const FCollisionAudioPreset> NewPreset = FPhysicalAudioPresetRegistry::Get().FindImpactPreset(DataTableAsset, ImpactNameRef);
+	if (NewPreset.IsValid())
 	{
-		BindCollisionEvent();
+		ImpactPreset = NewPreset;
+		ImpactAudioData = &ImpactPreset->ImpactData;
+
+		if (!bCollisionEventBound)
+		{
+			BindCollisionEvent();
+		}
 	}
 }
 
@@ -53,8 +86,16 @@ void UCollisionAudioComponent::BindCollisionEvent()
 	AActor* Owner = GetOwner();
 	if (Owner)
 	{
-		TArray<UPrimitiveComponent*> CollisionComponents;
-		Owner->GetComponents(CollisionComponents, false);
+		TInlineComponentArray<UPrimitiveComponent*> CollisionComponents(Owner);
+
+		// Rebinding, drop the routes of the previous components first
+		if (bHitsRouted && Subsystem)
+		{
+			Subsystem->UnregisterImpactRoutes(this);
+		}
+		NotifyComponents.Reset();
+
+		const bool bRouteHits = bRouteHitsThroughSubsystem && Subsystem != nullptr;
 
 		bool bHasCollisionComponent = false;
 		for (UPrimitiveComponent* PrimitiveComponent : CollisionComponents)
@@ -62,23 +103,114 @@ void UCollisionAudioComponent::BindCollisionEvent()
 			if (PrimitiveComponent->ComponentHasTag(CollisionComponentTag))
 			{
 				bHasCollisionComponent = true;
-				PrimitiveComponent->OnComponentHit.AddUniqueDynamic(this, &UCollisionAudioComponent::OnTaggedComponentHit);
+				if (!bRouteHits)
+				{
+					PrimitiveComponent->OnComponentHit.AddUniqueDynamic(this, &UCollisionAudioComponent::OnTaggedComponentHit);
+				}
+				NotifyComponents.Add(PrimitiveComponent);
 			}
 		}
 
 		if (!bHasCollisionComponent)
 		{
-			Owner->OnActorHit.AddUniqueDynamic(this, &UCollisionAudioComponent::OnActorHit);
+			if (!bRouteHits)
+			{
+				Owner->OnActorHit.AddUniqueDynamic(this, &UCollisionAudioComponent::OnActorHit);
+			}
+
+			// Actor hits come from every component that notifies
+			for (UPrimitiveComponent* PrimitiveComponent : CollisionComponents)
+			{
+				if (PrimitiveComponent->BodyInstance.bNotifyRigidBodyCollision)
+				{
+					NotifyComponents.Add(PrimitiveComponent);
+				}
+			}
 		}
+
+		// Routed hits are dispatched by the subsystem, which listens to every routed component with one handler
+		if (bRouteHits)
+		{
+			Subsystem->RegisterImpactRoutes(this);
+		}
+		bHitsRouted = bRouteHits;
+
+		bCollisionEventBound = true;
 	}
 }
 
 void UCollisionAudioComponent::OnImpactHandle(FVector NormalImpulse, const FHitResult& Hit)
+{
+	HandleImpact(NormalImpulse, Hit.Location);
+}
+
+void UCollisionAudioComponent::HandleImpact(FVector NormalImpulse, FVector Location)
+{
+	SCOPE_CYCLE_COUNTER(STAT_PhysicalAudio_OnImpactHandle);
+
+	// No preset row found yet, nothing to play
+	if (ImpactAudioData == nullptr)
+		return;
+
+	// A replay raises the recorded hits itself, the live ones are not part of it
+	FPhysicalAudioCapture& Capture = FPhysicalAudioCapture::Get();
+	if (Capture.IsReplaying() && !Capture.IsInjectingHits())
+		return;
+
+	if (Capture.IsRecording())
+	{
+		Capture.RecordHit(this, NormalImpulse, Location);
+	}
+
+	if (bCoalesceImpacts && Subsystem)
+	{
+		// First contact of the frame, the subsystem resolves it once physics is done
+		if (PendingImpact.NumContacts == 0)
+		{
+			Subsystem->QueueImpact(this);
+		}
+
+		if (PendingImpact.NumContacts == 0 || NormalImpulse.SizeSquared() > PendingImpact.Impulse.SizeSquared())
+		{
+			PendingImpact.Impulse = NormalImpulse;
+			PendingImpact.Location = Location;
+		}
+		++PendingImpact.NumContacts;
+		return;
+	}
+
+	ProcessImpact(NormalImpulse, Location);
+}
+
+void UCollisionAudioComponent::ResolvePendingImpact()
+{
+	if (PendingImpact.NumContacts == 0)
+		return;
+
+	const FCollisionAudioPendingImpact Impact = PendingImpact;
+	PendingImpact = FCollisionAudioPendingImpact();
+
+	ProcessImpact(Impact.Impulse, Impact.Location);
+}
+
+void UCollisionAudioComponent::ProcessImpact(FVector NormalImpulse, FVector Location)
 {
 	if (DetectValidHit(NormalImpulse))
 	{
-		ImpulseMagnitude = UKismetMathLibrary::MapRangeClamped(NormalImpulse.Size(), ImpactAudioData.ImpactMagnitudeThresholdMin, ImpactAudioData.ImpactMagnitudeThresholdMax, 0.f, 1.f);
-		PlayImpactSound(Hit.Location);
+		ImpulseMagnitude = UKismetMathLibrary::MapRangeClamped(NormalImpulse.Size(), ImpactAudioData->ImpactMagnitudeThresholdMin, ImpactAudioData->ImpactMagnitudeThresholdMax, 0.f, 1.f);
+		PHYSICALAUDIO_TRACE_RECORD(this, EPhysicalAudioTraceType::ImpactAccepted, 0, 0, ImpulseMagnitude);
+
+		PlayImpactSound(Location);
+
+		if (Subsystem && Subsystem->HasEventListeners())
+		{
+			FPhysicalAudioEventRecord Event;
+			Event.Component = this;
+			Event.Type = EPhysicalAudioEventType::Impact;
+			Event.Intensity = ImpulseMagnitude;
+			Event.Location = Location;
+			Subsystem->RecordEvent(Event);
+		}
 
 		UpdateLastTriggerStatus(GetOwner()->GetTransform());
 
@@ -88,7 +220,7 @@ void UCollisionAudioComponent::OnImpactHandle(FVector NormalImpulse, const FHitR
 		if (bDebugImpactMsg)
 		{
 			FString Msg = FString::Printf(TEXT("Collision Impulse Magnitude : %s(%d)"), *NormalImpulse.ToString(), NormalImpulse.Size());
-			UKismetSystemLibrary::DrawDebugString(this, Hit.Location, Msg, nullptr, FColor::White, 3.f);
+			UKismetSystemLibrary::DrawDebugString(this, Location, Msg, nullptr, FColor::White, 3.f);
 		}
 #endif
 	}
@@ -106,48 +238,118 @@ void UCollisionAudioComponent::OnTaggedComponentHit(UPrimitiveComponent* HitComp
 
 bool UCollisionAudioComponent::DetectValidHit(FVector Impulse)
 {
+	if (ImpactAudioData == nullptr)
+		return false;
+
 	ImpulseMagnitude = Impulse.Size();
 
-	if (bCanPlay && bCanEverPlay &&
-		IsTriggerDeltaThreshold() &&
-		IsRetriggerCooldown() &&
-		IsImpulseAllow(ImpulseMagnitude))
+	const float Time = UKismetSystemLibrary::GetGameTimeInSeconds(this);
+
+	if (bCanPlay && bCanEverPlay)
 	{
-		return true;
+		PhysicalAudioCore::FImpactGate Gate;
+		Gate.ImpulseThresholdMin = ImpactAudioData->ImpactMagnitudeThresholdMin;
+		Gate.RetriggerCooldown = ImpactAudioData->RetriggerCooldown;
+		Gate.LastTriggerTime = LastTriggerGameTime;
+		Gate.bSkipDeltaThreshold = bDisableDeltaThreshold || bFirstHit;
+
+		const PhysicalAudioCore::EImpactRejection Rejection = PhysicalAudioCore::ValidateImpact(Gate, ImpulseMagnitude, Time, [this]() { return HasMovedSinceLastTrigger(); });
+		switch (Rejection)
+		{
+		case PhysicalAudioCore::EImpactRejection::None:
+			return true;
+
+		case PhysicalAudioCore::EImpactRejection::Impulse:
+			INC_DWORD_STAT(STAT_PhysicalAudio_RejectedHitsImpulse);
+			PHYSICALAUDIO_TRACE_RECORD(this, EPhysicalAudioTraceType::ImpactRejected, 0, static_cast<uint8>(EPhysicalAudioTraceRejection::Impulse), ImpulseMagnitude);
+			break;
+
+		case PhysicalAudioCore::EImpactRejection::Cooldown:
+			INC_DWORD_STAT(STAT_PhysicalAudio_RejectedHitsCooldown);
+			PHYSICALAUDIO_TRACE_RECORD(this, EPhysicalAudioTraceType::ImpactRejected, 0, static_cast<uint8>(EPhysicalAudioTraceRejection::Cooldown), ImpulseMagnitude);
+			break;
+
+		case PhysicalAudioCore::EImpactRejection::DeltaThreshold:
+			INC_DWORD_STAT(STAT_PhysicalAudio_RejectedHitsDeltaThreshold);
+			PHYSICALAUDIO_TRACE_RECORD(this, EPhysicalAudioTraceType::ImpactRejected, 0, static_cast<uint8>(EPhysicalAudioTraceRejection::DeltaThreshold), ImpulseMagnitude);
+			break;
+		}
 	}
 
-	LastInvalidHitGameTime = UKismetSystemLibrary::GetGameTimeInSeconds(this);
+	LastInvalidHitGameTime = Time;
 	return false;
 }
 
 void UCollisionAudioComponent::PlayImpactSound(FVector Location)
 {
+	SCOPE_CYCLE_COUNTER(STAT_PhysicalAudio_PlayImpactSound);
+
+	if (ImpactAudioData == nullptr)
+		return;
+
 	USoundBase* Sound;
 	float Volume = 1.f;
 	float Pitch = 1.f;
 
 	if (ImpulseMagnitude >= 1)
 	{
-		Sound = ImpactAudioData.SoundHeavy;
+		Sound = FPhysicalAudioPresetRegistry::Get().GetLoadedSound(ImpactAudioData->SoundHeavy);
 	}
 	else
 	{
-		Sound = ImpactAudioData.SoundDefault;
-		Volume = UKismetMathLibrary::MapRangeClamped(ImpulseMagnitude, 0.f, 1.f, ImpactAudioData.VolumeModulationMin, ImpactAudioData.VolumeModulationMax);
-		Pitch = UKismetMathLibrary::MapRangeClamped(ImpulseMagnitude, 0.f, 1.f, ImpactAudioData.PitchModulationMin, ImpactAudioData.PitchModulationMax);
+		Sound = FPhysicalAudioPresetRegistry::Get().GetLoadedSound(ImpactAudioData->SoundDefault);
+		Volume = UKismetMathLibrary::MapRangeClamped(ImpulseMagnitude, 0.f, 1.f, ImpactAudioData->VolumeModulationMin, ImpactAudioData->VolumeModulationMax);
+		Pitch = UKismetMathLibrary::MapRangeClamped(ImpulseMagnitude, 0.f, 1.f, ImpactAudioData->PitchModulationMin, ImpactAudioData->PitchModulationMax);
 	}
 
-	UGameplayStatics::PlaySoundAtLocation(this, Sound, Location, Volume, Pitch);
-	if (OnPlayCollisionSound.IsBound())
+	if (Sound == nullptr)
+	{
+		return;
+	}
+
+	FPhysicalAudioVoiceRequest Request;
+	Request.Owner = this;
+	Request.Requester = this;
+	Request.Sound = Sound;
+	Request.Location = Location;
+	Request.Intensity = ImpulseMagnitude;
+	Request.VolumeMultiplier = Volume;
+	Request.PitchMultiplier = Pitch;
+
+	Request.ClusterId = ImpactPreset->ClusterId;
+
+	if (Subsystem)
+	{
+		// Started by the voice budget if it makes the cut
+		Subsystem->SubmitVoice(Request);
+	}
+	else
 	{
-		OnPlayCollisionSound.Broadcast(this, Sound);
+		StartBudgetedVoice(Request);
 	}
 }
 
-bool UCollisionAudioComponent::IsTriggerDeltaThreshold()
+void UCollisionAudioComponent::StartBudgetedVoice(const FPhysicalAudioVoiceRequest& Request)
 {
-	if (bDisableDeltaThreshold || bFirstHit) return true;
+	float Volume = Request.VolumeMultiplier;
+	float Pitch = Request.PitchMultiplier;
 
+	// Merged impacts play louder with their combined intensity
+	if (Request.NumMerged > 1 && Request.Sound == ImpactAudioData->SoundDefault.Get())
+	{
+		Volume = UKismetMathLibrary::MapRangeClamped(Request.Intensity, 0.f, 1.f, ImpactAudioData->VolumeModulationMin, ImpactAudioData->VolumeModulationMax);
+		Pitch = UKismetMathLibrary::MapRangeClamped(Request.Intensity, 0.f, 1.f, ImpactAudioData->PitchModulationMin, ImpactAudioData->PitchModulationMax);
+	}
+
+	UGameplayStatics::PlaySoundAtLocation(this, Request.Sound, Request.Location, Volume, Pitch);
+	if (OnPlayCollisionSound.IsBound())
+	{
+		OnPlayCollisionSound.Broadcast(this, Request.Sound);
+	}
+}
+
+bool UCollisionAudioComponent::HasMovedSinceLastTrigger() const
+{
 	return !UKismetMathLibrary::NearlyEqual_TransformTransform(LastTriggerTransform, GetOwner()->GetTransform(), TriggerLocationDeltaThreshold, TriggerRotationDeltaThreshold, 0.0001f);
 }
 
@@ -1,18 +1,47 @@
 // Copyright 1998-2017 Epic Games, Inc. All Rights Reserved.
 
 #include "PhysicalAudio.h"
+#include "PhysicalAudioStats.h"
+#include "PhysicalAudioPresetRegistry.h"
 
 #define LOCTEXT_NAMESPACE "FPhysicalAudioModule"
 
+DEFINE_LOG_CATEGORY(LogPhysicalAudio);
+
+DEFINE_STAT(STAT_PhysicalAudio_Tick);
+DEFINE_STAT(STAT_PhysicalAudio_Flush);
+DEFINE_STAT(STAT_PhysicalAudio_UpdateTrackedBones);
+DEFINE_STAT(STAT_PhysicalAudio_ApplyTrackingEvents);
+DEFINE_STAT(STAT_PhysicalAudio_PlaySoundFromBone);
+DEFINE_STAT(STAT_PhysicalAudio_OnImpactHandle);
+DEFINE_STAT(STAT_PhysicalAudio_PlayImpactSound);
+DEFINE_STAT(STAT_PhysicalAudio_ActiveComponents);
+DEFINE_STAT(STAT_PhysicalAudio_EvaluatedBones);
+DEFINE_STAT(STAT_PhysicalAudio_EventsLoopStart);
+DEFINE_STAT(STAT_PhysicalAudio_EventsLoopStop);
+DEFINE_STAT(STAT_PhysicalAudio_EventsMedium);
+DEFINE_STAT(STAT_PhysicalAudio_EventsFast);
+DEFINE_STAT(STAT_PhysicalAudio_EventsLoopModulated);
+DEFINE_STAT(STAT_PhysicalAudio_LoopVolumePushes);
+DEFINE_STAT(STAT_PhysicalAudio_RejectedHitsImpulse);
+DEFINE_STAT(STAT_PhysicalAudio_RejectedHitsCooldown);
+DEFINE_STAT(STAT_PhysicalAudio_RejectedHitsDeltaThreshold);
+DEFINE_STAT(STAT_PhysicalAudio_LiveLoops);
+DEFINE_STAT(STAT_PhysicalAudio_TrackedStateMemory);
+
 void FPhysicalAudioModule::StartupModule()
 {
 	// This code will execute after your module is loaded into memory; the exact timing is specified in the .uplugin file per-module
+	PresetRegistry = MakeUnique<FPhysicalAudioPresetRegistry>();
+	FPhysicalAudioPresetRegistry::Instance = PresetRegistry.Get();
 }
 
 void FPhysicalAudioModule::ShutdownModule()
 {
 	// This function may be called during shutdown to clean up your module.  For modules that support dynamic reloading,
 	// we call this function before unloading the module.
+	FPhysicalAudioPresetRegistry::Instance = nullptr;
+	PresetRegistry.Reset();
 }
 
 #undef LOCTEXT_NAMESPACE
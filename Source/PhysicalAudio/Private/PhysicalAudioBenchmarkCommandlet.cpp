@@ -0,0 +1,445 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicalAudio.h"
+#include "PhysicalAudioBenchmarkCommandlet.h"
+#include "PhysicalAudioComponent.h"
+#include "CollisionAudioComponent.h"
+#include "PhysicalAudioSubsystem.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+#include "Engine/DataTable.h"
+#include "Engine/SkeletalMesh.h"
+#include "Engine/StaticMesh.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Dom/JsonObject.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonWriter.h"
+#include "Serialization/JsonSerializer.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "HAL/PlatformTime.h"
+
+namespace PhysicalAudioBenchmark
+{
+	/* Counts allocations of the measured frames, forwards everything to the allocator it replaces. */
+	class FCountingMalloc : public FMalloc
+	{
+	public:
+		explicit FCountingMalloc(FMalloc* InInnerMalloc)
+			: InnerMalloc(InInnerMalloc)
+			, NumAllocations(0)
+		{
+		}
+
+		virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+		{
+			FPlatformAtomics::InterlockedIncrement(&NumAllocations);
+			return InnerMalloc->Malloc(Count, Alignment);
+		}
+
+		virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			FPlatformAtomics::InterlockedIncrement(&NumAllocations);
+			return InnerMalloc->Realloc(Original, Count, Alignment);
+		}
+
+		virtual void Free(void* Original) override { InnerMalloc->Free(Original); }
+		virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return InnerMalloc->QuantizeSize(Count, Alignment); }
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return InnerMalloc->GetAllocationSize(Original, SizeOut); }
+		virtual void Trim() override { InnerMalloc->Trim(); }
+		virtual void SetupTLSCachesOnCurrentThread() override { InnerMalloc->SetupTLSCachesOnCurrentThread(); }
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override { InnerMalloc->ClearAndDisableTLSCachesOnCurrentThread(); }
+		virtual bool IsInternallyThreadSafe() const override { return InnerMalloc->IsInternallyThreadSafe(); }
+		virtual bool ValidateHeap() override { return InnerMalloc->ValidateHeap(); }
+		virtual const TCHAR* GetDescriptiveName() override { return InnerMalloc->GetDescriptiveName(); }
+
+		FORCEINLINE int64 GetNumAllocations() const { return NumAllocations; }
+
+		FMalloc* InnerMalloc;
+
+	private:
+		volatile int64 NumAllocations;
+	};
+
+	/* Per-frame samples of one metric. */
+	struct FMetric
+	{
+		FMetric(const TCHAR* InName)
+			: Name(InName)
+		{
+		}
+
+		const TCHAR* Name;
+		TArray<double> Samples;
+
+		double GetPercentile(float Percentile) const
+		{
+			TArray<double> Sorted = Samples;
+			Sorted.Sort();
+			return Sorted.Num() > 0 ? Sorted[FMath::Clamp(FMath::CeilToInt(Percentile * Sorted.Num()) - 1, 0, Sorted.Num() - 1)] : 0.0;
+		}
+
+		TSharedRef<FJsonObject> ToJson() const
+		{
+			double Sum = 0.0;
+			double Max = 0.0;
+			for (double Sample : Samples)
+			{
+				Sum += Sample;
+				Max = FMath::Max(Max, Sample);
+			}
+
+			TSharedRef<FJsonObject> Json = MakeShareable(new FJsonObject());
+			Json->SetNumberField(TEXT("Mean"), Samples.Num() > 0 ? Sum / Samples.Num() : 0.0);
+			Json->SetNumberField(TEXT("P50"), GetPercentile(0.50f));
+			Json->SetNumberField(TEXT("P95"), GetPercentile(0.95f));
+			Json->SetNumberField(TEXT("P99"), GetPercentile(0.99f));
+			Json->SetNumberField(TEXT("Max"), Max);
+			return Json;
+		}
+	};
+
+	/* Compare the p95 of every metric against @BaselinePath, false when one of them regressed past @Tolerance. */
+	bool CompareToBaseline(TSharedRef<FJsonObject> const& Metrics, const FString& BaselinePath, float Tolerance)
+	{
+		FString BaselineString;
+		TSharedPtr<FJsonObject> Baseline;
+		if (!FFileHelper::LoadFileToString(BaselineString, *BaselinePath) || !FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(BaselineString), Baseline) || !Baseline.IsValid())
+		{
+			UE_LOG(LogPhysicalAudio, Error, TEXT("Benchmark baseline %s could not be read."), *BaselinePath);
+			return false;
+		}
+
+		const TSharedPtr<FJsonObject>* BaselineMetrics = nullptr;
+		if (!Baseline->TryGetObjectField(TEXT("Metrics"), BaselineMetrics))
+		{
+			UE_LOG(LogPhysicalAudio, Error, TEXT("Benchmark baseline %s has no metrics."), *BaselinePath);
+			return false;
+		}
+
+		bool bPassed = true;
+		for (auto& Pair : Metrics->Values)
+		{
+			const TSharedPtr<FJsonObject>* BaselineMetric = nullptr;
+			if (!(*BaselineMetrics)->TryGetObjectField(Pair.Key, BaselineMetric))
+			{
+				continue;
+			}
+
+			const double Current = Pair.Value->AsObject()->GetNumberField(TEXT("P95"));
+			const double Reference = (*BaselineMetric)->GetNumberField(TEXT("P95"));
+			const bool bRegressed = Current > Reference * (1.0 + Tolerance) && Current - Reference > KINDA_SMALL_NUMBER;
+
+			UE_LOG(LogPhysicalAudio, Display, TEXT("%-20s p95 %10.4f baseline %10.4f %s"), *Pair.Key, Current, Reference, bRegressed ? TEXT("REGRESSED") : TEXT(""));
+			bPassed &= !bRegressed;
+		}
+
+		return bPassed;
+	}
+}
+
+UPhysicalAudioBenchmarkCommandlet::UPhysicalAudioBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+
+	ImpactRate = 0.2f;
+	ImpulseScale = 1.25f;
+}
+
+int32 UPhysicalAudioBenchmarkCommandlet::Main(const FString& Params)
+{
+	using namespace PhysicalAudioBenchmark;
+
+	int32 NumFrames = 600;
+	int32 NumWarmupFrames = 60;
+	int32 Seed = 0;
+	float DeltaTime = 1.f / 60.f;
+	float Tolerance = 0.1f;
+	FString OutputPath = FPaths::GameSavedDir() / TEXT("PhysicalAudio") / TEXT("Benchmark.json");
+	FString BaselinePath;
+
+	FParse::Value(*Params, TEXT("Frames="), NumFrames);
+	FParse::Value(*Params, TEXT("Warmup="), NumWarmupFrames);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FParse::Value(*Params, TEXT("DeltaTime="), DeltaTime);
+	FParse::Value(*Params, TEXT("ImpactRate="), ImpactRate);
+	FParse::Value(*Params, TEXT("ImpulseScale="), ImpulseScale);
+	FParse::Value(*Params, TEXT("Tolerance="), Tolerance);
+	FParse::Value(*Params, TEXT("Output="), OutputPath);
+	FParse::Value(*Params, TEXT("Baseline="), BaselinePath);
+
+	Random.Initialize(Seed);
+
+	// Transient game world, ticked by hand like the engine loop would
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("PhysicalAudioBenchmark"));
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	const FURL URL;
+	World->SetGameMode(URL);
+	World->InitializeActorsForPlay(URL);
+
+	SpawnActors(World, Params);
+
+	World->BeginPlay();
+
+	// Row sounds stream in with their presets, measure with everything loaded
+	FlushAsyncLoading();
+
+	for (FBenchmarkActor& BenchmarkActor : BenchmarkActors)
+	{
+		if (BenchmarkActor.PhysicalAudio)
+		{
+			BenchmarkActor.PhysicalAudio->SetCanPlay(true);
+		}
+		if (BenchmarkActor.CollisionAudio)
+		{
+			BenchmarkActor.CollisionAudio->SetCanPlay(true);
+		}
+	}
+
+	UPhysicalAudioSubsystem* Subsystem = UPhysicalAudioSubsystem::Get(World);
+	check(Subsystem);
+
+	FMetric TrackingMetric(TEXT("TrackingMs"));
+	FMetric ApplyMetric(TEXT("ApplyMs"));
+	FMetric ImpactMetric(TEXT("ImpactMs"));
+	FMetric FrameMetric(TEXT("FrameMs"));
+	FMetric AllocationMetric(TEXT("AllocationsPerFrame"));
+
+	FCountingMalloc* CountingMalloc = new FCountingMalloc(GMalloc);
+	GMalloc = CountingMalloc;
+
+	const uint64 UsedPhysicalAtStart = FPlatformMemory::GetStats().UsedPhysical;
+	const FPhysicalAudioSubsystemCounters StartCounters = Subsystem->GetCounters();
+	int64 NumImpacts = 0;
+
+	float Time = 0.f;
+	for (int32 Frame = 0; Frame < NumWarmupFrames + NumFrames; ++Frame)
+	{
+		const FPhysicalAudioSubsystemCounters FrameCounters = Subsystem->GetCounters();
+		const int64 FrameAllocations = CountingMalloc->GetNumAllocations();
+		const double FrameStart = FPlatformTime::Seconds();
+
+		const double ImpactSeconds = DriveFrame(Time, DeltaTime);
+
+		World->Tick(LEVELTICK_All, DeltaTime);
+		++GFrameCounter;
+
+		const double FrameSeconds = FPlatformTime::Seconds() - FrameStart;
+		Time += DeltaTime;
+
+		if (Frame < NumWarmupFrames)
+		{
+			continue;
+		}
+
+		const FPhysicalAudioSubsystemCounters& Counters = Subsystem->GetCounters();
+		TrackingMetric.Samples.Add(FPlatformTime::ToMilliseconds(Counters.TrackingCycles - FrameCounters.TrackingCycles));
+		ApplyMetric.Samples.Add(FPlatformTime::ToMilliseconds(Counters.ApplyCycles - FrameCounters.ApplyCycles));
+		ImpactMetric.Samples.Add(ImpactSeconds * 1000.0 + FPlatformTime::ToMilliseconds(Counters.FlushCycles - FrameCounters.FlushCycles));
+		FrameMetric.Samples.Add(FrameSeconds * 1000.0);
+		AllocationMetric.Samples.Add(CountingMalloc->GetNumAllocations() - FrameAllocations);
+	}
+
+	const FPhysicalAudioSubsystemCounters EndCounters = Subsystem->GetCounters();
+	const uint64 UsedPhysicalAtEnd = FPlatformMemory::GetStats().UsedPhysical;
+
+	// Other threads may still be inside the proxy, it is leaked on purpose
+	GMalloc = CountingMalloc->InnerMalloc;
+
+	// Report
+	TSharedRef<FJsonObject> Config = MakeShareable(new FJsonObject());
+	Config->SetStringField(TEXT("Params"), Params);
+	Config->SetNumberField(TEXT("Frames"), NumFrames);
+	Config->SetNumberField(TEXT("DeltaTime"), DeltaTime);
+	Config->SetNumberField(TEXT("Actors"), BenchmarkActors.Num());
+	Config->SetNumberField(TEXT("Seed"), Seed);
+
+	TSharedRef<FJsonObject> Metrics = MakeShareable(new FJsonObject());
+	for (FMetric const* Metric : { &TrackingMetric, &ApplyMetric, &ImpactMetric, &FrameMetric, &AllocationMetric })
+	{
+		Metrics->SetObjectField(Metric->Name, Metric->ToJson());
+	}
+
+	TSharedRef<FJsonObject> Totals = MakeShareable(new FJsonObject());
+	Totals->SetNumberField(TEXT("EventsApplied"), EndCounters.NumEventsApplied - StartCounters.NumEventsApplied);
+	Totals->SetNumberField(TEXT("VoicesSubmitted"), EndCounters.NumVoicesSubmitted - StartCounters.NumVoicesSubmitted);
+	Totals->SetNumberField(TEXT("VoicesRejected"), Subsystem->GetVoiceBudget().GetNumRejectedTotal());
+	Totals->SetNumberField(TEXT("MemoryGrowthBytes"), (double)((int64)UsedPhysicalAtEnd - (int64)UsedPhysicalAtStart));
+
+	TSharedRef<FJsonObject> Report = MakeShareable(new FJsonObject());
+	Report->SetObjectField(TEXT("Config"), Config);
+	Report->SetObjectField(TEXT("Metrics"), Metrics);
+	Report->SetObjectField(TEXT("Totals"), Totals);
+
+	FString ReportString;
+	FJsonSerializer::Serialize(Report, TJsonWriterFactory<>::Create(&ReportString));
+	if (FFileHelper::SaveStringToFile(ReportString, *OutputPath))
+	{
+		UE_LOG(LogPhysicalAudio, Display, TEXT("Benchmark report written to %s"), *OutputPath);
+	}
+	else
+	{
+		UE_LOG(LogPhysicalAudio, Error, TEXT("Benchmark report could not be written to %s"), *OutputPath);
+	}
+
+	const bool bPassed = BaselinePath.IsEmpty() || CompareToBaseline(Metrics, BaselinePath, Tolerance);
+
+	for (FBenchmarkActor& BenchmarkActor : BenchmarkActors)
+	{
+		BenchmarkActor.Actor->Destroy();
+	}
+	BenchmarkActors.Reset();
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+
+	return bPassed ? 0 : 1;
+}
+
+void UPhysicalAudioBenchmarkCommandlet::SpawnActors(UWorld* World, const FString& Params)
+{
+	int32 NumSkeletal = 64;
+	int32 NumCustom = 256;
+	int32 NumColliders = 256;
+	FString BoneTablePath, ImpactTablePath, SkeletalMeshPath, StaticMeshPath;
+	FName BoneRow, ImpactRow;
+
+	FParse::Value(*Params, TEXT("Skeletal="), NumSkeletal);
+	FParse::Value(*Params, TEXT("Custom="), NumCustom);
+	FParse::Value(*Params, TEXT("Colliders="), NumColliders);
+	FParse::Value(*Params, TEXT("BoneTable="), BoneTablePath);
+	FParse::Value(*Params, TEXT("BoneRow="), BoneRow);
+	FParse::Value(*Params, TEXT("ImpactTable="), ImpactTablePath);
+	FParse::Value(*Params, TEXT("ImpactRow="), ImpactRow);
+	FParse::Value(*Params, TEXT("SkeletalMesh="), SkeletalMeshPath);
+	FParse::Value(*Params, TEXT("StaticMesh="), StaticMeshPath);
+
+	UDataTable* BoneTable = BoneTablePath.IsEmpty() ? nullptr : LoadObject<UDataTable>(nullptr, *BoneTablePath);
+	UDataTable* ImpactTable = ImpactTablePath.IsEmpty() ? nullptr : LoadObject<UDataTable>(nullptr, *ImpactTablePath);
+	USkeletalMesh* SkeletalMesh = SkeletalMeshPath.IsEmpty() ? nullptr : LoadObject<USkeletalMesh>(nullptr, *SkeletalMeshPath);
+	UStaticMesh* StaticMesh = StaticMeshPath.IsEmpty() ? nullptr : LoadObject<UStaticMesh>(nullptr, *StaticMeshPath);
+
+	if (BoneTable == nullptr)
+	{
+		UE_LOG(LogPhysicalAudio, Warning, TEXT("No -BoneTable, tracked actors are skipped."));
+		NumSkeletal = NumCustom = 0;
+	}
+	if (SkeletalMesh == nullptr && NumSkeletal > 0)
+	{
+		UE_LOG(LogPhysicalAudio, Warning, TEXT("No -SkeletalMesh, skeletal actors are skipped."));
+		NumSkeletal = 0;
+	}
+	if (ImpactTable == nullptr && NumColliders > 0)
+	{
+		UE_LOG(LogPhysicalAudio, Warning, TEXT("No -ImpactTable, colliders are skipped."));
+		NumColliders = 0;
+	}
+
+	// Spread on a grid so the voice budget sees realistic distances
+	const int32 NumActors = NumSkeletal + NumCustom + NumColliders;
+	const int32 GridSize = FMath::Max(1, FMath::CeilToInt(FMath::Sqrt(NumActors)));
+	const float GridSpacing = 500.f;
+
+	FActorSpawnParameters SpawnParameters;
+	SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	for (int32 Index = 0; Index < NumActors; ++Index)
+	{
+		FBenchmarkActor BenchmarkActor;
+		BenchmarkActor.Origin = FVector((Index % GridSize) * GridSpacing, (Index / GridSize) * GridSpacing, 0.f);
+		BenchmarkActor.Phase = Random.FRandRange(0.f, 2.f * PI);
+		BenchmarkActor.Actor = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform(BenchmarkActor.Origin), SpawnParameters);
+		BenchmarkActor.PhysicalAudio = nullptr;
+		BenchmarkActor.CollisionAudio = nullptr;
+
+		UMeshComponent* Root;
+		if (Index < NumSkeletal)
+		{
+			USkeletalMeshComponent* SkeletalMeshComponent = NewObject<USkeletalMeshComponent>(BenchmarkActor.Actor);
+			SkeletalMeshComponent->SetSkeletalMesh(SkeletalMesh);
+			Root = SkeletalMeshComponent;
+		}
+		else
+		{
+			UStaticMeshComponent* StaticMeshComponent = NewObject<UStaticMeshComponent>(BenchmarkActor.Actor);
+			StaticMeshComponent->SetStaticMesh(StaticMesh);
+			Root = StaticMeshComponent;
+		}
+
+		Root->SetMobility(EComponentMobility::Movable);
+		BenchmarkActor.Actor->SetRootComponent(Root);
+		Root->RegisterComponent();
+
+		if (Index < NumSkeletal + NumCustom)
+		{
+			UPhysicalAudioComponent* PhysicalAudio = NewObject<UPhysicalAudioComponent>(BenchmarkActor.Actor);
+			PhysicalAudio->DataTableAsset = BoneTable;
+			PhysicalAudio->DataNameRef = BoneRow;
+			PhysicalAudio->SetupAttachment(Root);
+			PhysicalAudio->RegisterComponent();
+			BenchmarkActor.PhysicalAudio = PhysicalAudio;
+		}
+		else
+		{
+			UCollisionAudioComponent* CollisionAudio = NewObject<UCollisionAudioComponent>(BenchmarkActor.Actor);
+			CollisionAudio->DataTableAsset = ImpactTable;
+			CollisionAudio->ImpactNameRef = ImpactRow;
+			CollisionAudio->RegisterComponent();
+			BenchmarkActor.CollisionAudio = CollisionAudio;
+		}
+
+		BenchmarkActors.Add(BenchmarkActor);
+	}
+
+	UE_LOG(LogPhysicalAudio, Display, TEXT("Benchmark spawned %d skeletal, %d custom and %d colliding actors."), NumSkeletal, NumCustom, NumColliders);
+}
+
+double UPhysicalAudioBenchmarkCommandlet::DriveFrame(float Time, float DeltaTime)
+{
+	double ImpactSeconds = 0.0;
+
+	for (FBenchmarkActor& BenchmarkActor : BenchmarkActors)
+	{
+		// Bursts of fast motion between slow drifts, so every threshold gets crossed
+		const float T = Time + BenchmarkActor.Phase;
+		const float Amplitude = 50.f + 150.f * FMath::Square(FMath::Sin(T * 0.5f));
+		const FVector Location = BenchmarkActor.Origin + FVector(FMath::Sin(T * 3.1f), FMath::Cos(T * 2.3f), FMath::Sin(T * 1.7f)) * Amplitude;
+		const FRotator Rotation(FMath::Sin(T * 1.3f) * 90.f, T * 120.f, 0.f);
+
+		BenchmarkActor.Actor->SetActorLocationAndRotation(Location, Rotation);
+
+		UPhysicalAudioComponent* PhysicalAudio = BenchmarkActor.PhysicalAudio;
+		if (PhysicalAudio && !PhysicalAudio->bIsSkeletalMesh)
+		{
+			for (int32 Slot = 0; Slot < PhysicalAudio->BoneState.Num(); ++Slot)
+			{
+				const FVector BoneOffset(FMath::Sin(T * 4.f + Slot), FMath::Cos(T * 5.f + Slot), 0.f);
+				PhysicalAudio->SetCustomTrackedTransform(Slot, FTransform(Rotation, Location + BoneOffset * Amplitude * 0.25f));
+			}
+		}
+
+		UCollisionAudioComponent* CollisionAudio = BenchmarkActor.CollisionAudio;
+		if (CollisionAudio && CollisionAudio->ImpactAudioData && Random.FRand() < ImpactRate)
+		{
+			FHitResult Hit;
+			Hit.Location = Location;
+			Hit.ImpactPoint = Location;
+
+			// Relative to the row so light and heavy hits both happen
+			const float MaxImpulse = CollisionAudio->ImpactAudioData->ImpactMagnitudeThresholdMax * ImpulseScale;
+			const FVector Impulse = Random.GetUnitVector() * Random.FRandRange(0.f, MaxImpulse);
+
+			const double StartTime = FPlatformTime::Seconds();
+			CollisionAudio->OnImpactHandle(Impulse, Hit);
+			ImpactSeconds += FPlatformTime::Seconds() - StartTime;
+		}
+	}
+
+	return ImpactSeconds;
+}
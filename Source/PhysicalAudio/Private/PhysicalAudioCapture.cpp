@@ -0,0 +1,364 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicalAudio.h"
+#include "PhysicalAudioCapture.h"
+#include "PhysicalAudioComponent.h"
+#include "PhysicalAudioSubsystem.h"
+#include "CollisionAudioComponent.h"
+#include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Serialization/MemoryReader.h"
+
+static const uint32 PhysicalAudioCaptureMagic = 0x50434150; // "PACP"
+static const uint32 PhysicalAudioCaptureVersion = 1;
+
+static void StartPhysicalAudioRecording(const TArray<FString>& Args)
+{
+	if (Args.Num() > 0)
+	{
+		FPhysicalAudioCapture::Get().StartRecording(Args[0]);
+	}
+}
+
+static void StartPhysicalAudioReplay(const TArray<FString>& Args)
+{
+	if (Args.Num() > 0)
+	{
+		FPhysicalAudioCapture::Get().StartReplay(Args[0]);
+	}
+}
+
+static void StopPhysicalAudioCapture()
+{
+	FPhysicalAudioCapture::Get().Stop();
+}
+
+static FAutoConsoleCommand CmdPhysicalAudioCaptureRecord(
+	TEXT("pa.Capture.Record"),
+	TEXT("Record tracked transforms and hits of the next frames into the given file, until pa.Capture.Stop."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&StartPhysicalAudioRecording));
+
+static FAutoConsoleCommand CmdPhysicalAudioCaptureReplay(
+	TEXT("pa.Capture.Replay"),
+	TEXT("Feed the given capture to the physical audio components instead of their meshes and hits."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&StartPhysicalAudioReplay));
+
+static FAutoConsoleCommand CmdPhysicalAudioCaptureStop(
+	TEXT("pa.Capture.Stop"),
+	TEXT("Stop the physical audio recording or replay."),
+	FConsoleCommandDelegate::CreateStatic(&StopPhysicalAudioCapture));
+
+FPhysicalAudioCapture& FPhysicalAudioCapture::Get()
+{
+	static FPhysicalAudioCapture Capture;
+	return Capture;
+}
+
+FPhysicalAudioCapture::FPhysicalAudioCapture()
+	: Writer(nullptr)
+	, bIsReplaying(false)
+	, bInjectingHits(false)
+	, bReportedDivergence(false)
+	, ReplayFrame(0)
+{
+}
+
+bool FPhysicalAudioCapture::StartRecording(const FString& FileName)
+{
+	Stop();
+
+	Writer = IFileManager::Get().CreateFileWriter(*FileName);
+	if (Writer == nullptr)
+	{
+		UE_LOG(LogPhysicalAudio, Warning, TEXT("Physical audio capture %s could not be created."), *FileName);
+		return false;
+	}
+
+	uint32 Magic = PhysicalAudioCaptureMagic;
+	uint32 Version = PhysicalAudioCaptureVersion;
+	*Writer << Magic << Version;
+
+	UE_LOG(LogPhysicalAudio, Display, TEXT("Recording physical audio capture to %s"), *FileName);
+	return true;
+}
+
+bool FPhysicalAudioCapture::StartReplay(const FString& FileName)
+{
+	Stop();
+
+	if (!LoadReplay(FileName))
+	{
+		Stop();
+		UE_LOG(LogPhysicalAudio, Warning, TEXT("Physical audio capture %s could not be read."), *FileName);
+		return false;
+	}
+
+	bIsReplaying = true;
+	UE_LOG(LogPhysicalAudio, Display, TEXT("Replaying physical audio capture %s, %d frames"), *FileName, Frames.Num());
+	return true;
+}
+
+void FPhysicalAudioCapture::Stop()
+{
+	if (Writer)
+	{
+		Writer->Close();
+		delete Writer;
+		Writer = nullptr;
+	}
+	RecordIds.Reset();
+
+	bIsReplaying = false;
+	bReportedDivergence = false;
+	ReplayFrame = 0;
+	Frames.Reset();
+	Bones.Reset();
+	Slots.Reset();
+	Hits.Reset();
+	ReplayNames.Reset();
+	ReplayObjects.Reset();
+	FrameBones.Reset();
+}
+
+bool FPhysicalAudioCapture::LoadReplay(const FString& FileName)
+{
+	// 4.15 has no mapped file API, captures are read in one go and parsed up front instead
+	TArray<uint8> Data;
+	if (!FFileHelper::LoadFileToArray(Data, *FileName))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(Data);
+
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	Reader << Magic << Version;
+	if (Magic != PhysicalAudioCaptureMagic || Version != PhysicalAudioCaptureVersion)
+	{
+		return false;
+	}
+
+	while (!Reader.AtEnd() && !Reader.IsError())
+	{
+		uint8 Chunk = 0;
+		Reader << Chunk;
+
+		switch (static_cast<EChunk>(Chunk))
+		{
+		case EChunk::Frame:
+		{
+			FFrameRecord& Frame = Frames[Frames.AddUninitialized()];
+			Reader << Frame.DeltaTime << Frame.TimeDilation;
+			Frame.FirstBones = Bones.Num();
+			Frame.NumBones = 0;
+			Frame.FirstHit = Hits.Num();
+			Frame.NumHits = 0;
+		} break;
+
+		case EChunk::Name:
+		{
+			uint32 Id = 0;
+			FString Name;
+			Reader << Id << Name;
+			if (Id >= (uint32)ReplayNames.Num())
+			{
+				ReplayNames.SetNum(Id + 1);
+				ReplayObjects.SetNum(Id + 1);
+			}
+			ReplayNames[Id] = Name;
+		} break;
+
+		case EChunk::Bones:
+		{
+			FBonesRecord& Record = Bones[Bones.AddUninitialized()];
+			uint16 NumSlots = 0;
+			Reader << Record.Id << NumSlots;
+			Record.FirstSlot = Slots.Num();
+			Record.NumSlots = NumSlots;
+
+			for (int32 Index = 0; Index < NumSlots; ++Index)
+			{
+				FSlotRecord& Slot = Slots[Slots.AddUninitialized()];
+				Reader << Slot.Slot << Slot.OldPosition << Slot.NewPosition << Slot.OldRotation << Slot.NewRotation;
+			}
+
+			if (Frames.Num() > 0)
+			{
+				++Frames.Last().NumBones;
+			}
+		} break;
+
+		case EChunk::Hit:
+		{
+			FHitRecord& Record = Hits[Hits.AddUninitialized()];
+			Reader << Record.Id << Record.NormalImpulse << Record.Location;
+
+			if (Frames.Num() > 0)
+			{
+				++Frames.Last().NumHits;
+			}
+		} break;
+
+		default:
+			return false;
+		}
+	}
+
+	return !Reader.IsError();
+}
+
+void FPhysicalAudioCapture::BeginFrame(FPhysicalAudioFrameContext& InOutContext)
+{
+	if (IsRecording())
+	{
+		uint8 Chunk = static_cast<uint8>(EChunk::Frame);
+		*Writer << Chunk << InOutContext.DeltaTime << InOutContext.TimeDilation;
+		return;
+	}
+
+	if (!IsReplaying())
+		return;
+
+	if (ReplayFrame >= Frames.Num())
+	{
+		UE_LOG(LogPhysicalAudio, Display, TEXT("Physical audio replay finished after %d frames"), ReplayFrame);
+		Stop();
+		return;
+	}
+
+	FFrameRecord const& Frame = Frames[ReplayFrame++];
+	InOutContext.DeltaTime = Frame.DeltaTime;
+	InOutContext.TimeDilation = Frame.TimeDilation;
+
+	FrameBones.Reset();
+	for (int32 Index = Frame.FirstBones; Index < Frame.FirstBones + Frame.NumBones; ++Index)
+	{
+		if (UObject* Object = ResolveReplayId(Bones[Index].Id))
+		{
+			FrameBones.Add(Object, Index);
+		}
+	}
+
+	// Hits recorded during the frame are raised before tracking, their voices go through the same budget flush
+	bInjectingHits = true;
+	for (int32 Index = Frame.FirstHit; Index < Frame.FirstHit + Frame.NumHits; ++Index)
+	{
+		FHitRecord const& Record = Hits[Index];
+		if (UCollisionAudioComponent* Component = Cast<UCollisionAudioComponent>(ResolveReplayId(Record.Id)))
+		{
+			Component->HandleImpact(Record.NormalImpulse, Record.Location);
+		}
+	}
+	bInjectingHits = false;
+}
+
+void FPhysicalAudioCapture::ReplayTrackedBones(UPhysicalAudioComponent* Component)
+{
+	if (!Component->bEvaluatePending)
+		return;
+
+	FTrackedBoneState& BoneState = Component->BoneState;
+	Component->bReplayingInput = true;
+
+	int32 const* BonesIndex = FrameBones.Find(Component);
+	const int32 NumRecorded = BonesIndex ? Bones[*BonesIndex].NumSlots : 0;
+	bool bDiverged = NumRecorded != BoneState.DueSlots.Num();
+
+	for (int32 Index = 0; Index < NumRecorded && !bDiverged; ++Index)
+	{
+		FSlotRecord const& Record = Slots[Bones[*BonesIndex].FirstSlot + Index];
+		const int32 Slot = BoneState.DueSlots[Index];
+		if (Record.Slot != Slot)
+		{
+			bDiverged = true;
+			break;
+		}
+
+		if (BoneState.BodyIndices[Slot] != INDEX_NONE)
+		{
+			BoneState.BodyVelocities[Slot] = Record.NewPosition;
+			continue;
+		}
+
+		BoneState.OldPositions[Slot] = Record.OldPosition;
+		BoneState.NewPositions[Slot] = Record.NewPosition;
+		BoneState.OldRotations[Slot] = Record.OldRotation;
+		BoneState.NewRotations[Slot] = Record.NewRotation;
+	}
+
+	if (bDiverged && !bReportedDivergence)
+	{
+		bReportedDivergence = true;
+		UE_LOG(LogPhysicalAudio, Warning, TEXT("Physical audio replay diverged at frame %d on %s, its schedule no longer matches the capture."), ReplayFrame - 1, *Component->GetPathName());
+	}
+}
+
+void FPhysicalAudioCapture::RecordTrackedBones(UPhysicalAudioComponent* Component)
+{
+	FTrackedBoneState const& BoneState = Component->BoneState;
+	if (!Component->bEvaluatePending || BoneState.DueSlots.Num() == 0)
+		return;
+
+	uint32 Id = GetRecordId(Component);
+	uint8 Chunk = static_cast<uint8>(EChunk::Bones);
+	uint16 NumSlots = (uint16)BoneState.DueSlots.Num();
+	*Writer << Chunk << Id << NumSlots;
+
+	for (int32 Slot : BoneState.DueSlots)
+	{
+		// Body slots have no transform history, their velocity goes in place of the new position
+		const bool bBodySlot = BoneState.BodyIndices[Slot] != INDEX_NONE;
+
+		uint16 RecordedSlot = (uint16)Slot;
+		FVector OldPosition = bBodySlot ? FVector::ZeroVector : BoneState.OldPositions[Slot];
+		FVector NewPosition = bBodySlot ? BoneState.BodyVelocities[Slot] : BoneState.NewPositions[Slot];
+		FQuat OldRotation = BoneState.OldRotations[Slot];
+		FQuat NewRotation = BoneState.NewRotations[Slot];
+		*Writer << RecordedSlot << OldPosition << NewPosition << OldRotation << NewRotation;
+	}
+}
+
+void FPhysicalAudioCapture::RecordHit(UCollisionAudioComponent* Component, const FVector& NormalImpulse, const FVector& Location)
+{
+	uint32 Id = GetRecordId(Component);
+	uint8 Chunk = static_cast<uint8>(EChunk::Hit);
+	FVector RecordedImpulse = NormalImpulse;
+	FVector RecordedLocation = Location;
+	*Writer << Chunk << Id << RecordedImpulse << RecordedLocation;
+}
+
+uint32 FPhysicalAudioCapture::GetRecordId(UObject* Object)
+{
+	if (uint32 const* Id = RecordIds.Find(Object))
+	{
+		return *Id;
+	}
+
+	uint32 Id = RecordIds.Num();
+	RecordIds.Add(Object, Id);
+
+	uint8 Chunk = static_cast<uint8>(EChunk::Name);
+	FString Name = Object->GetPathName();
+	*Writer << Chunk << Id << Name;
+
+	return Id;
+}
+
+UObject* FPhysicalAudioCapture::ResolveReplayId(uint32 Id)
+{
+	if (!ReplayNames.IsValidIndex(Id))
+	{
+		return nullptr;
+	}
+
+	UObject* Object = ReplayObjects[Id].Get();
+	if (Object == nullptr)
+	{
+		Object = FindObject<UObject>(nullptr, *ReplayNames[Id]);
+		ReplayObjects[Id] = Object;
+	}
+
+	return Object;
+}
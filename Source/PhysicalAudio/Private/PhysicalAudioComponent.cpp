@@ -2,15 +2,41 @@
 
 #include "PhysicalAudio.h"
 #include "PhysicalAudioComponent.h"
+#include "PhysicalAudioSubsystem.h"
+#include "PhysicalAudioPresetRegistry.h"
+#include "PhysicalAudioKernels.h"
+#include "PhysicalAudioStats.h"
+#include "PhysicalAudioTrace.h"
+#include "PhysicalAudioCapture.h"
 #include "PhysicalUtils.h"
 #include "Components/SkeletalMeshComponent.h"
+#include "PhysicsEngine/BodyInstance.h"
+#include "PhysicsEngine/PhysicsAsset.h"
 #include "Components/AudioComponent.h"
 #include "Kismet/GameplayStatics.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<int32> CVarPhysicalAudioSleepQuietUpdates(
+	TEXT("pa.Sleep.QuietUpdates"),
+	30,
+	TEXT("Consecutive updates without movement before a tracked component goes to sleep. 0 to only sleep on rigid body sleep events."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarPhysicalAudioSleepDeltaTolerance(
+	TEXT("pa.Sleep.DeltaTolerance"),
+	0.001f,
+	TEXT("Tracked bone delta under which an update counts as quiet."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarPhysicalAudioSleepProbeInterval(
+	TEXT("pa.Sleep.ProbeInterval"),
+	0.25f,
+	TEXT("Seconds between two checks of a sleeping component for movement, the only wake up for bodies without bGenerateWakeEvents."),
+	ECVF_Default);
 
 
 FTrackedBone::FTrackedBone()
-	: Controller()
-	, BoneName("Invalid")
+	: BoneName("Invalid")
 	, SoundCueLoop()
 	, SoundCueMedium()
 	, SoundCueHigh()
@@ -20,365 +46,1109 @@ FTrackedBone::FTrackedBone()
 	, RetriggerDelay()
 	, TrackingSpace(ETrackedBoneSpace::Relative)
 	, VelocityTrackingType(ETrackedBoneVelocityType::Rotational)
-	, LoopInstance()
-	, Delta()
-	, TimeSinceLastTrigger()
-	, bTriggeredLoopLayer()
-	, InterpolatedVolume()
-	, TorqueCurrent()
-	, TorqueFinal()
-	, OldRotation()
-	, NewRotation()
+	, bImportant(false)
+	, UpdateRate(0.f)
+	, bUseBodyVelocity(false)
 {
 }
 
-#if WITH_EDITORONLY_DATA
-ETrackedBoneEvent FTrackedBone::Update(UPhysicalAudioComponent* Owner, USkeletalMeshComponent* Mesh, float DeltaTime, float TimeDilation, bool bIgnoreDilation, float InterpSpeed, float VolumeMultiplier, bool DebugOn)
-#else
-ETrackedBoneEvent FTrackedBone::Update(USkeletalMeshComponent* Mesh, float DeltaTime, float TimeDilation, bool bIgnoreDilation, float InterpSpeed, float VolumeMultiplier)
-#endif
+void FTrackedBoneState::Reset(int32 NumSlots)
+{
+	VelocityTypes.Init(ETrackedBoneVelocityType::Rotational, NumSlots);
+	BoneIndices.Init(INDEX_NONE, NumSlots);
+	ActiveSlots.Reset(NumSlots);
+
+	UpdateIntervals.Init(0.f, NumSlots);
+	PendingTimes.Init(0.f, NumSlots);
+	TimesSinceSample.Init(0.f, NumSlots);
+	ElapsedTimes.Init(0.f, NumSlots);
+
+	OldPositions.Init(FVector::ZeroVector, NumSlots);
+	NewPositions.Init(FVector::ZeroVector, NumSlots);
+	FilteredForces.Init(FVector::ZeroVector, NumSlots);
+	PreviousTriggerVectors.Init(FVector::ZeroVector, NumSlots);
+
+	OldRotations.Init(FQuat(0.f, 0.f, 0.f, 0.f), NumSlots);
+	NewRotations.Init(FQuat(0.f, 0.f, 0.f, 0.f), NumSlots);
+	FilteredTorques.Init(FQuat(0.f, 0.f, 0.f, 0.f), NumSlots);
+
+	BodyIndices.Init(INDEX_NONE, NumSlots);
+	BodyVelocities.Init(FVector::ZeroVector, NumSlots);
+
+	Deltas.Init(0.f, NumSlots);
+	ThresholdsLoop.Init(0.f, NumSlots);
+	ThresholdsMedium.Init(0.f, NumSlots);
+	ThresholdsHigh.Init(0.f, NumSlots);
+
+	TimesSinceLastTrigger.Init(0.f, NumSlots);
+	InterpolatedVolumes.Init(0.f, NumSlots);
+	PushedLoopVolumes.Init(0.f, NumSlots);
+	LoopPushTimes.Init(-MAX_FLT, NumSlots);
+	PreviousLoopVolumes.Init(0.f, NumSlots);
+	DirectionChangedSinceLastTrigger.Init(false, NumSlots);
+
+	LoopInstances.Init(nullptr, NumSlots);
+
+	const int32 NumMaskWords = PhysicalAudioKernels::GetNumMaskWords(NumSlots);
+	DueSlots.Reset(NumSlots);
+	LinearSlots.Reset(NumSlots);
+	RotationalSlots.Reset(NumSlots);
+	BodySlots.Reset(NumSlots);
+	AboveLoopMask.Init(0, NumMaskWords);
+	AboveMediumMask.Init(0, NumMaskWords);
+	AboveHighMask.Init(0, NumMaskWords);
+}
+
+SIZE_T FTrackedBoneState::GetAllocatedSize() const
+{
+	return VelocityTypes.GetAllocatedSize() + BoneIndices.GetAllocatedSize() + ActiveSlots.GetAllocatedSize()
+		+ UpdateIntervals.GetAllocatedSize() + PendingTimes.GetAllocatedSize() + TimesSinceSample.GetAllocatedSize() + ElapsedTimes.GetAllocatedSize()
+		+ OldPositions.GetAllocatedSize() + NewPositions.GetAllocatedSize() + FilteredForces.GetAllocatedSize() + PreviousTriggerVectors.GetAllocatedSize()
+		+ OldRotations.GetAllocatedSize() + NewRotations.GetAllocatedSize() + FilteredTorques.GetAllocatedSize()
+		+ BodyIndices.GetAllocatedSize() + BodyVelocities.GetAllocatedSize()
+		+ Deltas.GetAllocatedSize() + ThresholdsLoop.GetAllocatedSize() + ThresholdsMedium.GetAllocatedSize() + ThresholdsHigh.GetAllocatedSize()
+		+ TimesSinceLastTrigger.GetAllocatedSize() + InterpolatedVolumes.GetAllocatedSize() + DirectionChangedSinceLastTrigger.GetAllocatedSize()
+		+ PushedLoopVolumes.GetAllocatedSize() + LoopPushTimes.GetAllocatedSize() + PreviousLoopVolumes.GetAllocatedSize()
+		+ LoopInstances.GetAllocatedSize()
+		+ DueSlots.GetAllocatedSize() + LinearSlots.GetAllocatedSize() + RotationalSlots.GetAllocatedSize() + BodySlots.GetAllocatedSize()
+		+ AboveLoopMask.GetAllocatedSize() + AboveMediumMask.GetAllocatedSize() + AboveHighMask.GetAllocatedSize();
+}
+
+float FTrackedBoneState::GetRangeMappedDelta(int32 Slot, float Left, float Right) const
+{
+	return PhysicalAudioCore::MapRangeClamped(Deltas[Slot], Left, Right);
+}
+
+void FTrackedBoneState::GetCurrentDeltaFromMesh(int32 Slot, FTrackedBone const& Bone, USkeletalMeshComponent* Mesh)
+{
+	GetCurrentDeltaFromPose(Slot, Bone.TrackingSpace, Mesh->GetComponentSpaceTransforms(), Mesh->GetComponentTransform());
+}
+
+void FTrackedBoneState::GetCurrentDeltaFromPose(int32 Slot, ETrackedBoneSpace Space, TArray<FTransform> const& ComponentSpaceTransforms, FTransform const& ComponentTransform)
+{
+	const int32 BoneIndex = BoneIndices[Slot];
+	if (!ComponentSpaceTransforms.IsValidIndex(BoneIndex))
+	{
+		return;
+	}
+
+	FTransform const& SpaceTransform = ComponentSpaceTransforms[BoneIndex];
+
+	// Store previous information
+	OldRotations[Slot] = NewRotations[Slot];
+	OldPositions[Slot] = NewPositions[Slot];
+
+	// Switch coordinate spaces for tracking current information
+	switch (Space)
+	{
+	case ETrackedBoneSpace::Relative:
+	{
+		// Component transform relative to the bone's world transform, which reduces to the inverse component space pose
+		FTransform RelTransform = SpaceTransform.Inverse();
+		NewRotations[Slot] = RelTransform.GetRotation();
+		NewPositions[Slot] = RelTransform.GetLocation();
+	} break;
+	case ETrackedBoneSpace::World:
+	{
+		FTransform Transform = SpaceTransform * ComponentTransform;
+		NewRotations[Slot] = Transform.GetRotation();
+		NewPositions[Slot] = Transform.GetLocation();
+	} break;
+	}
+}
+
+void FTrackedBoneState::GetCurrentDeltaFromTransform(int32 Slot, FTransform const& Transform)
+{
+	// Store previous information
+	OldRotations[Slot] = NewRotations[Slot];
+	OldPositions[Slot] = NewPositions[Slot];
+
+	// Update to new information
+	NewRotations[Slot] = Transform.GetRotation();
+	NewPositions[Slot] = Transform.GetLocation();
+}
+
+void FTrackedBoneState::GetCurrentVelocityFromBody(int32 Slot, USkeletalMeshComponent const* Mesh)
+{
+	const int32 BodyIndex = BodyIndices[Slot];
+	FBodyInstance* Body = Mesh->Bodies.IsValidIndex(BodyIndex) ? Mesh->Bodies[BodyIndex] : nullptr;
+
+	if (Body == nullptr || !Body->IsInstanceSimulatingPhysics())
+	{
+		BodyVelocities[Slot] = FVector::ZeroVector;
+		return;
+	}
+
+	BodyVelocities[Slot] = VelocityTypes[Slot] == ETrackedBoneVelocityType::Linear ? Body->GetUnrealWorldVelocity() : Body->GetUnrealWorldAngularVelocity();
+}
+
+void FTrackedBoneState::ResetLoop(int32 Slot, UPhysicalAudioSubsystem* Pool)
+{
+	if (LoopInstances[Slot])
+	{
+		LoopInstances[Slot]->FadeOut(0.5f, 0.0f);
+
+		// Back to the pool once faded out
+		if (Pool)
+		{
+			Pool->ReleaseAudioComponent(LoopInstances[Slot]);
+		}
+
+		LoopInstances[Slot] = nullptr;
+		InterpolatedVolumes[Slot] = 0.0f;
+		PushedLoopVolumes[Slot] = 0.0f;
+		LoopPushTimes[Slot] = -MAX_FLT;
+		PreviousLoopVolumes[Slot] = 0.0f;
+
+		DEC_DWORD_STAT(STAT_PhysicalAudio_LiveLoops);
+	}
+}
+
+FPhysicalAudioData::FPhysicalAudioData()
+	: TrackedBones()
+	, LoopVolumeDeadband(0.01f)
+	, LoopUpdateRate(30.f)
+{
+}
+
+// Sets default values for this component's properties
+UPhysicalAudioComponent::UPhysicalAudioComponent()
+{
+	// Tracking is ticked in batch by UPhysicalAudioSubsystem, see EvaluateTracking
+	PrimaryComponentTick.bCanEverTick = false;
+
+	bVisible = false; // We don't draw anything (and probably should just be an ActorComponent)
+	bUseAttachParentBound = true; // Avoid CalcBounds() when transform changes.
+	bNeverNeedsRenderUpdate = true;
+
+	bShouldIgnoreDilation = false;
+	bShouldAttachOneShots = false;
+	bCanPlay = false;
+	TrackedBones = nullptr;
+	Subsystem = nullptr;
+	ResolvedSkeletalMesh = nullptr;
+	ResolvedLODLevel = INDEX_NONE;
+	Significance = EPhysicalAudioSignificance::Full;
+	PendingDeltaTime = 0.f;
+	PendingFrames = 0;
+	bEvaluatePending = true;
+	bPrimeTracking = false;
+	bReplayingInput = false;
+	StaggerSeed = 0;
+	bIsAsleep = false;
+	QuietUpdates = 0;
+	TimeSinceWakeProbe = 0.f;
+	TrackedStateMemory = 0;
+	InterpSpeed = 50;
+	VolumeMultiplier = 1.0f;
+}
+
+
+// Called when the game starts
+void UPhysicalAudioComponent::BeginPlay()
 {
-	// Measure time since last sound cue trigger
-	TimeSinceLastTrigger += DeltaTime;
+	Super::BeginPlay();
+
+	// Locate parented skeletal mesh component, for tracking Bones and listening for broken constraints
+	Mesh = Cast<USkeletalMeshComponent>(PhysicalUtils::FindFirstParentOfClass(this, USkeletalMeshComponent::StaticClass()));
+	if (Mesh == nullptr)
+	{
+		bIsSkeletalMesh = false;
+		Mesh = Cast<UStaticMeshComponent>(PhysicalUtils::FindFirstParentOfClass(this, UStaticMeshComponent::StaticClass()));
+	}
+	else
+	{
+		bIsSkeletalMesh = true;
+	}
+
+	// We can detach from parent now, since we've cached the mesh reference
+	DetachFromComponent(FDetachmentTransformRules::KeepRelativeTransform);
+
+	StaggerSeed = FCrc::StrCrc32(*GetPathName());
+
+	// Fill-out data from table based on Name Ref
+	ResetDataFromTable();
+	ResolveBoneIndices(Cast<USkeletalMeshComponent>(Mesh));
+
+	// Dead ragdolls and settled props go dormant with their bodies.
+	// Only bodies created with bGenerateWakeEvents (mesh or physics asset) send these, the flag is read once when the
+	// physics actor is created so setting it now would do nothing. ProbeWake catches the bodies without it.
+	if (Mesh)
+	{
+		Mesh->OnComponentSleep.AddUniqueDynamic(this, &UPhysicalAudioComponent::OnMeshSleep);
+		Mesh->OnComponentWake.AddUniqueDynamic(this, &UPhysicalAudioComponent::OnMeshWake);
+	}
+
+	// Subsystem skips us until SetCanPlay(true)
+	if (UPhysicalAudioSubsystem* PhysicalAudioSubsystem = GetSubsystem())
+	{
+		PhysicalAudioSubsystem->RegisterComponent(this);
+	}
+}
+
+void UPhysicalAudioComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Loop layers are pooled, they don't go away with our owner
+	for (int32 Slot = 0; Slot < BoneState.Num(); ++Slot)
+	{
+		BoneState.ResetLoop(Slot, Subsystem);
+	}
+
+	if (Subsystem)
+	{
+		Subsystem->UnregisterComponent(this);
+	}
+
+	DEC_MEMORY_STAT_BY(STAT_PhysicalAudio_TrackedStateMemory, TrackedStateMemory);
+	TrackedStateMemory = 0;
+
+	if (Mesh)
+	{
+		Mesh->OnComponentSleep.RemoveDynamic(this, &UPhysicalAudioComponent::OnMeshSleep);
+		Mesh->OnComponentWake.RemoveDynamic(this, &UPhysicalAudioComponent::OnMeshWake);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UPhysicalAudioComponent::PrepareTracking(const FPhysicalAudioFrameContext& Context)
+{
+	const int32 MaxQuietUpdates = CVarPhysicalAudioSleepQuietUpdates.GetValueOnGameThread();
+	if (MaxQuietUpdates > 0 && QuietUpdates >= MaxQuietUpdates && !FPhysicalAudioCapture::Get().IsActive())
+	{
+		Sleep();
+		bEvaluatePending = false;
+		return;
+	}
+
+	PendingDeltaTime += Context.DeltaTime;
+	++PendingFrames;
+
+	bEvaluatePending = Significance != EPhysicalAudioSignificance::Throttled || PendingFrames >= Context.ThrottledInterval;
+	if (!bEvaluatePending)
+		return;
+
+	USkeletalMeshComponent* SktMesh = bIsSkeletalMesh ? Cast<USkeletalMeshComponent>(Mesh) : nullptr;
+
+	// Bone indices only change with the mesh asset or LOD, name lookups happen there instead of every frame
+	if (SktMesh && (SktMesh->SkeletalMesh != ResolvedSkeletalMesh || SktMesh->PredictedLODLevel != ResolvedLODLevel))
+	{
+		ResolveBoneIndices(SktMesh);
+	}
+
+	ScheduleTrackedBones(PendingDeltaTime);
+
+	// Physics bodies aren't safe to read from the tracking workers, gather their velocities here
+	if (SktMesh)
+	{
+		for (int32 Slot : BoneState.DueSlots)
+		{
+			if (BoneState.BodyIndices[Slot] != INDEX_NONE)
+			{
+				BoneState.GetCurrentVelocityFromBody(Slot, SktMesh);
+			}
+		}
+	}
 
-	// Poll current/previous location from actor's Bone
 	// HACK: Use "Custom" velocity tracking type to allow BP to specify custom Transform to track
-	if (VelocityTrackingType != ETrackedBoneVelocityType::Custom)
+	BroadcastCustomTrackedTick(BoneState.DueSlots);
+}
+
+void UPhysicalAudioComponent::BroadcastCustomTrackedTick(TArray<int32> const& Slots)
+{
+	if (!TrackedBones || !OnCustomTrackedTick.IsBound())
+		return;
+
+	for (int32 Slot : Slots)
 	{
-		if (Mesh && Mesh->GetBoneIndex(BoneName) != INDEX_NONE)
+		if (BoneState.VelocityTypes[Slot] == ETrackedBoneVelocityType::Custom)
 		{
-			GetCurrentDeltaFromMesh(Mesh);
+			OnCustomTrackedTick.Broadcast((*TrackedBones)[Slot]);
 		}
-		else
+	}
+}
+
+void UPhysicalAudioComponent::EvaluateTracking(const FPhysicalAudioFrameContext& Context, TArray<FTrackedBoneEventRecord>& OutEvents)
+{
+	// Warning: the subsystem only calls us while registered and bCanPlay (see SetCanPlay)
+	// We must be parented to a skeletal mesh component for Bone information to be read
+	if (bCanPlay && Mesh && TrackedBones)
+	{
+		USkeletalMeshComponent const* SktMesh = bIsSkeletalMesh ? Cast<USkeletalMeshComponent>(Mesh) : nullptr;
+
+		// Skipped frame of a throttled component, see PrepareTracking
+		if (!bEvaluatePending)
+			return;
+
+		// Hitches are clamped to 1/45 per elapsed frame, far components catch up on the frames they skipped
+		const float MaxStep = PendingFrames / 45.f;
+		PendingDeltaTime = 0.f;
+		PendingFrames = 0;
+
+		float TimeScale = 1.f;
+		if (bShouldIgnoreDilation)
+		{
+			TimeScale = 1.0f / Context.TimeDilation;
+		}
+
+		UpdateTrackedBones(SktMesh, MaxStep, TimeScale);
+		bReplayingInput = false;
+		INC_DWORD_STAT_BY(STAT_PhysicalAudio_EvaluatedBones, BoneState.DueSlots.Num());
+
+		// Evaluate the tracked Bone slots updated this frame, ElapsedTimes now holds their filter time step
+		for (int32 Slot : BoneState.DueSlots)
+		{
+			ETrackedBoneEvent Result = EvaluateTrackedBone(Slot, BoneState.ElapsedTimes[Slot]);
+
+			switch (Result)
+			{
+			case ETrackedBoneEvent::None:
+				break;
+
+			case ETrackedBoneEvent::MediumThreshold:
+			{
+				FTrackedBone const& VTS = (*TrackedBones)[Slot];
+				OutEvents.Emplace(Slot, Result, BoneState.GetRangeMappedDelta(Slot, VTS.ThresholdMedium, VTS.ThresholdHigh));
+			} break;
+
+			case ETrackedBoneEvent::LoopModulated:
+				OutEvents.Emplace(Slot, Result, BoneState.InterpolatedVolumes[Slot]);
+				break;
+
+			default:
+				OutEvents.Emplace(Slot, Result, 1.0f);
+				break;
+			}
+		}
+
+		// Nothing moving and nothing left to fade out, see PrepareTracking
+		if (BoneState.DueSlots.Num() > 0)
+		{
+			const float DeltaTolerance = CVarPhysicalAudioSleepDeltaTolerance.GetValueOnAnyThread();
+
+			bool bIsQuiet = true;
+			for (int32 Slot : BoneState.DueSlots)
+			{
+				if (BoneState.Deltas[Slot] > DeltaTolerance || BoneState.LoopInstances[Slot])
+				{
+					bIsQuiet = false;
+					break;
+				}
+			}
+
+			QuietUpdates = bIsQuiet ? QuietUpdates + 1 : 0;
+		}
+	}
+}
+
+void UPhysicalAudioComponent::ApplyTrackingEvents(TArray<FTrackedBoneEventRecord> const& Events)
+{
+	SCOPE_CYCLE_COUNTER(STAT_PhysicalAudio_ApplyTrackingEvents);
+
+	if (!IsTrackingActive() || !TrackedBones)
+		return;
+
+	const float Now = GetWorld()->GetRealTimeSeconds();
+	const bool bAddFrameEvents = Subsystem && Subsystem->HasEventListeners();
+
+	// Events are in slot order, applied in the order they were thrown
+	for (FTrackedBoneEventRecord const& Record : Events)
+	{
+		const int32 Slot = Record.Slot;
+		FTrackedBone const& VTS = (*TrackedBones)[Slot];
+
+		// Delegates may have stopped us
+		if (!bCanPlay)
+			break;
+
+		PHYSICALAUDIO_TRACE_RECORD(this, EPhysicalAudioTraceType::Event, Slot, static_cast<uint8>(Record.Event), Record.Intensity);
+
+		// Receive events thrown by tracked Bones
+		switch (Record.Event)
+		{
+		case ETrackedBoneEvent::SlowThresholdStart:
+		{
+			INC_DWORD_STAT(STAT_PhysicalAudio_EventsLoopStart);
+
+			BoneState.ResetLoop(Slot, Subsystem);
+			BoneState.LoopInstances[Slot] = PlaySoundFromBone(Slot, VTS.SoundCueLoop, 0.0f, true);
+
+			if (BoneState.LoopInstances[Slot])
+			{
+				INC_DWORD_STAT(STAT_PhysicalAudio_LiveLoops);
+			}
+
+			if (OnLoopSoundTriggered.IsBound())
+			{
+				OnLoopSoundTriggered.Broadcast(BoneState.LoopInstances[Slot]);
+			}
+
+			if (bAddFrameEvents)
+			{
+				AddFrameEvent(Slot, EPhysicalAudioEventType::LoopStart, Record.Intensity);
+			}
+		} break;
+
+		case ETrackedBoneEvent::SlowThresholdStop:
+			INC_DWORD_STAT(STAT_PhysicalAudio_EventsLoopStop);
+
+			if (UAudioComponent* LoopInstance = BoneState.LoopInstances[Slot])
+			{
+				LoopInstance->Stop();
+				BoneState.LoopInstances[Slot] = nullptr;
+				DEC_DWORD_STAT(STAT_PhysicalAudio_LiveLoops);
+
+				if (Subsystem)
+				{
+					Subsystem->ReleaseAudioComponent(LoopInstance);
+				}
+				else
+				{
+					LoopInstance->DestroyComponent();
+				}
+			}
+
+			if (bAddFrameEvents)
+			{
+				AddFrameEvent(Slot, EPhysicalAudioEventType::LoopStop, Record.Intensity);
+			}
+			break;
+
+		case ETrackedBoneEvent::MediumThreshold:
+		case ETrackedBoneEvent::FastThreshold:
+			if (Record.Event == ETrackedBoneEvent::MediumThreshold)
+			{
+				INC_DWORD_STAT(STAT_PhysicalAudio_EventsMedium);
+			}
+			else
+			{
+				INC_DWORD_STAT(STAT_PhysicalAudio_EventsFast);
+			}
+
+			if (bAddFrameEvents)
+			{
+				AddFrameEvent(Slot, Record.Event == ETrackedBoneEvent::MediumThreshold ? EPhysicalAudioEventType::Medium : EPhysicalAudioEventType::Fast, Record.Intensity);
+			}
+
+			if (Subsystem)
+			{
+				USoundBase* Sound = FPhysicalAudioPresetRegistry::Get().GetLoadedSound(Record.Event == ETrackedBoneEvent::MediumThreshold ? VTS.SoundCueMedium : VTS.SoundCueHigh);
+				if (Sound == nullptr)
+				{
+					break;
+				}
+
+				// Started by the voice budget if it makes the cut, see StartBudgetedVoice
+				FPhysicalAudioVoiceRequest Request;
+				Request.Owner = this;
+				Request.Requester = this;
+				Request.Sound = Sound;
+				Request.Location = GetSlotLocation(Slot);
+				Request.Intensity = Record.Intensity;
+				Request.VolumeMultiplier = Record.Intensity;
+				Request.Payload = Slot;
+				Request.PayloadEvent = static_cast<uint8>(Record.Event);
+
+				Subsystem->SubmitVoice(Request);
+			}
+			else
+			{
+				PlayOneShot(Slot, Record.Event, Record.Intensity);
+			}
+			break;
+
+		case ETrackedBoneEvent::LoopModulated:
+			INC_DWORD_STAT(STAT_PhysicalAudio_EventsLoopModulated);
+
+			// Fade in/out and pitch up/down loop layer based on normalized movement delta
+			if (UAudioComponent* LoopInstance = BoneState.LoopInstances[Slot])
+			{
+				const float Volume = Record.Intensity * VolumeMultiplier;
+				const bool bPush = PhysicalAudioCore::ShouldPushLoopParameter(Volume, BoneState.PreviousLoopVolumes[Slot], BoneState.PushedLoopVolumes[Slot],
+					Preset->LoopVolumeDeadband, Now - BoneState.LoopPushTimes[Slot], Preset->LoopUpdateInterval);
+
+				BoneState.PreviousLoopVolumes[Slot] = Volume;
+				if (!bPush)
+					break;
+
+				INC_DWORD_STAT(STAT_PhysicalAudio_LoopVolumePushes);
+				BoneState.PushedLoopVolumes[Slot] = Volume;
+				BoneState.LoopPushTimes[Slot] = Now;
+
+				OnLoopSoundModulated.Broadcast(LoopInstance, Record.Intensity);
+
+				if (bAddFrameEvents)
+				{
+					AddFrameEvent(Slot, EPhysicalAudioEventType::LoopModulated, Record.Intensity);
+				}
+
+				if (Subsystem)
+				{
+					Subsystem->QueueLoopVolume(LoopInstance, Volume);
+				}
+				else
+				{
+					LoopInstance->SetVolumeMultiplier(Volume);
+				}
+			}
+			break;
+		}
+	}
+}
+
+void UPhysicalAudioComponent::AddFrameEvent(int32 Slot, EPhysicalAudioEventType Type, float Intensity)
+{
+	FPhysicalAudioEventRecord Event;
+	Event.Component = this;
+	Event.Slot = Slot;
+	Event.Type = Type;
+	Event.Intensity = Intensity;
+	Event.Location = GetSlotLocation(Slot);
+
+	Subsystem->RecordEvent(Event);
+}
+
+void UPhysicalAudioComponent::TraceTrackingState() const
+{
+#if PHYSICALAUDIO_TRACE
+	FPhysicalAudioTrace& Trace = FPhysicalAudioTrace::Get();
+	const int32 TraceComponentIndex = bEvaluatePending ? Trace.FindTracedComponent(this) : INDEX_NONE;
+	if (TraceComponentIndex == INDEX_NONE)
+		return;
+
+	for (int32 Slot : BoneState.DueSlots)
+	{
+		Trace.Record(TraceComponentIndex, EPhysicalAudioTraceType::BoneSample, Slot, 0, BoneState.Deltas[Slot], BoneState.InterpolatedVolumes[Slot]);
+	}
+#endif
+}
+
+#if WITH_EDITORONLY_DATA
+void UPhysicalAudioComponent::DrawTrackingDebug()
+{
+	if (!bEnableDebug || !TrackedBones)
+		return;
+
+	USkeletalMeshComponent const* SktMesh = bIsSkeletalMesh ? Cast<USkeletalMeshComponent>(Mesh) : nullptr;
+
+	for (int32 Slot : BoneState.ActiveSlots)
+	{
+		const float Delta = BoneState.Deltas[Slot];
+		if (Delta > 0.f)
 		{
-			return ETrackedBoneEvent::None;
+			const int32 BoneIndex = BoneState.BoneIndices[Slot];
+			FString Msg = FString::Printf(TEXT("Delta: %f bDirectionChangedSinceLastTrigger: %s TimeSinceLastTrigger: %f"), Delta, BoneState.DirectionChangedSinceLastTrigger[Slot] ? TEXT("True") : TEXT("False"), BoneState.TimesSinceLastTrigger[Slot]);
+			PhysicalUtils::DumpMsg(this, (SktMesh == nullptr || BoneIndex == INDEX_NONE) ? FVector::ZeroVector : SktMesh->GetBoneTransform(BoneIndex).GetLocation(), Msg, FColor::Red, 2);
 		}
 	}
+}
+#endif
 
-	// Calculate delta time
-	float NewDeltaTime = FMath::Min(DeltaTime, 1.f / 45.f);
-	if (bIgnoreDilation)
+void UPhysicalAudioComponent::StartBudgetedVoice(const FPhysicalAudioVoiceRequest& Request)
+{
+	if (IsTrackingActive() && TrackedBones && BoneState.LoopInstances.IsValidIndex(Request.Payload))
 	{
-		float InverseDilation = 1.0f / TimeDilation;
-		NewDeltaTime = InverseDilation * NewDeltaTime;
+		PlayOneShot(Request.Payload, static_cast<ETrackedBoneEvent>(Request.PayloadEvent), Request.VolumeMultiplier);
 	}
+}
+
+void UPhysicalAudioComponent::PlayOneShot(int32 Slot, ETrackedBoneEvent Event, float Volume)
+{
+	FTrackedBone const& VTS = (*TrackedBones)[Slot];
+
+	switch (Event)
+	{
+	case ETrackedBoneEvent::MediumThreshold:
+	{
+		// Determine whether or not we need to create an audio component for this one-shot
+		bool bUseAudioComponent = false;
+		if (OnMediumSoundTriggered.IsBound() || bShouldAttachOneShots)
+		{
+			bUseAudioComponent = true;
+		}
+
+		// Listeners keep the component, it can't come from the pool
+		const bool bPooled = !OnMediumSoundTriggered.IsBound();
+
+		// Trigger sound to play, modulate volume based on intensity of movement delta
+		UAudioComponent* MediumSound = PlaySoundFromBone(Slot, VTS.SoundCueMedium, Volume, bUseAudioComponent, bPooled);
+
+		if (bUseAudioComponent && MediumSound)
+		{
+			if (bPooled)
+			{
+				// One-shot, back to the pool once finished
+				if (Subsystem)
+				{
+					Subsystem->ReleaseAudioComponent(MediumSound);
+				}
+			}
+			else
+			{
+				OnMediumSoundTriggered.Broadcast(MediumSound, Volume);
+			}
+		}
+	} break;
 
-	// Linear/angular velocity tracking
-	if (VelocityTrackingType == ETrackedBoneVelocityType::Rotational)
+	case ETrackedBoneEvent::FastThreshold:
 	{
-		// Calculate and interpolate to new torque
-		TorqueCurrent = (NewRotation - OldRotation) / NewDeltaTime;
+		// Determine whether or not we need to create an audio component for this one-shot
+		bool bUseAudioComponent = false;
+		if (OnHeavySoundTriggered.IsBound() || bShouldAttachOneShots)
+		{
+			bUseAudioComponent = true;
+		}
+
+		// Listeners keep the component, it can't come from the pool
+		const bool bPooled = !OnHeavySoundTriggered.IsBound();
+
+		// Trigger sound to play, modulate volume based on intensity of movement delta
+		UAudioComponent* HeavySound = PlaySoundFromBone(Slot, VTS.SoundCueHigh, 1.0f, bUseAudioComponent, bPooled);
+
+		if (bUseAudioComponent && HeavySound)
+		{
+			if (bPooled)
+			{
+				// One-shot, back to the pool once finished
+				if (Subsystem)
+				{
+					Subsystem->ReleaseAudioComponent(HeavySound);
+				}
+			}
+			else
+			{
+				OnHeavySoundTriggered.Broadcast(HeavySound);
+			}
+		}
+	} break;
 
-		FQuat RotDelta = TorqueCurrent - TorqueFinal;
+	default:
+		break;
+	}
+}
 
-		TorqueFinal += RotDelta * NewDeltaTime * InterpSpeed;
+FVector UPhysicalAudioComponent::GetTrackedLocation() const
+{
+	return Mesh ? Mesh->GetComponentLocation() : GetComponentLocation();
+}
 
-		Delta = RotDelta.Size();
-	}
-	else if (VelocityTrackingType == ETrackedBoneVelocityType::Linear)
+FVector UPhysicalAudioComponent::GetSlotLocation(int32 Slot) const
+{
+	const int32 BoneIndex = BoneState.BoneIndices[Slot];
+	if (BoneIndex != INDEX_NONE)
 	{
-		// Calculate and interpolate to new velocity
-		ForceCurrent = (NewPosition - OldPosition) / NewDeltaTime;
+		return CastChecked<USkeletalMeshComponent>(Mesh)->GetBoneTransform(BoneIndex).GetLocation();
+	}
 
-		FVector PosDelta = ForceCurrent - ForceFinal;
+	return Mesh->GetSocketLocation((*TrackedBones)[Slot].BoneName);
+}
 
-		ForceFinal += PosDelta * NewDeltaTime * InterpSpeed;
+bool UPhysicalAudioComponent::IsSlotSignificant(int32 Slot) const
+{
+	return Significance == EPhysicalAudioSignificance::Full || Preset->bAllBonesImportant || (*TrackedBones)[Slot].bImportant;
+}
 
-		Delta = PosDelta.Size();
-	}
-	else if (VelocityTrackingType == ETrackedBoneVelocityType::Custom)
-	{
-		// Calculate and interpolate to new torque
-		TorqueCurrent = (NewRotation - OldRotation) / NewDeltaTime;
-		FQuat RotDelta = TorqueCurrent - TorqueFinal;
-		TorqueFinal += RotDelta * NewDeltaTime * InterpSpeed;
+void UPhysicalAudioComponent::ResolveBoneIndices(USkeletalMeshComponent* SktMesh)
+{
+	const bool bMeshChanged = !SktMesh || SktMesh->SkeletalMesh != ResolvedSkeletalMesh;
 
-		PreviousTriggerQuat = RotDelta;
+	ResolvedSkeletalMesh = SktMesh ? SktMesh->SkeletalMesh : nullptr;
+	ResolvedLODLevel = SktMesh ? SktMesh->PredictedLODLevel : INDEX_NONE;
 
-		// Calculate and interpolate to new velocity
-		ForceCurrent = (NewPosition - OldPosition) / NewDeltaTime;
-		FVector PosDelta = ForceCurrent - ForceFinal;
-		ForceFinal += PosDelta * NewDeltaTime * InterpSpeed;
+	BoneState.ActiveSlots.Reset();
 
-		Delta = PosDelta.Size() + RotDelta.Size();
+	for (int32 Slot = 0; Slot < BoneState.Num(); ++Slot)
+	{
+		if (!IsSlotSignificant(Slot))
+		{
+			BoneState.ResetLoop(Slot, Subsystem);
+			continue;
+		}
 
-		// Examine this delta against the previous delta (POSITION ONLY), to see if it's an abrupt change in direction
-		FVector CurrentTriggerVector = NewPosition - OldPosition;
-		CurrentTriggerVector.Normalize();
+		if (BoneState.VelocityTypes[Slot] == ETrackedBoneVelocityType::Custom)
+		{
+			BoneState.ActiveSlots.Add(Slot);
+			continue;
+		}
 
-		float DotFromLastTrigger = FVector::DotProduct(CurrentTriggerVector, PreviousTriggerVector);
+		FTrackedBone const& Bone = (*TrackedBones)[Slot];
+		const int32 PreviousBoneIndex = BoneState.BoneIndices[Slot];
 
-		if (DotFromLastTrigger <= 0.0f && CurrentTriggerVector.Size() >= ThresholdMedium / 2.0f)
+		int32 BoneIndex = SktMesh ? SktMesh->GetBoneIndex(Bone.BoneName) : INDEX_NONE;
+		if (BoneIndex == INDEX_NONE)
 		{
-			bDirectionChangedSinceLastTrigger = true;
+			if (bMeshChanged)
+			{
+				UE_LOG(LogPhysicalAudio, Warning, TEXT("%s: tracked bone %s not found, slot %d disabled."), *GetPathName(), *Bone.BoneName.ToString(), Slot);
+			}
 		}
-		else
+		else if (SktMesh->RequiredBones.Num() > 0 && !SktMesh->RequiredBones.Contains(static_cast<FBoneIndexType>(BoneIndex)))
 		{
-			bDirectionChangedSinceLastTrigger = false;
+			// Not evaluated at this LOD, its transform would stay frozen
+			BoneIndex = INDEX_NONE;
 		}
 
-		PreviousTriggerVector = CurrentTriggerVector;
-	}
+		BoneState.BoneIndices[Slot] = BoneIndex;
 
-#if WITH_EDITORONLY_DATA
-	if (DebugOn && Delta > 0.f)
-	{
-		FString Msg = FString::Printf(TEXT("Delta: %f bDirectionChangedSinceLastTrigger: %s TimeSinceLastTrigger: %f"), Delta, bDirectionChangedSinceLastTrigger ? TEXT("True") : TEXT("False"), TimeSinceLastTrigger);
-		PhysicalUtils::DumpMsg(Owner, Mesh == nullptr ? FVector::ZeroVector : Mesh->GetSocketLocation(BoneName), Msg, Delta > 0.f ? FColor::Red : FColor::White, Delta > 0.f ? 2 : 0);
-	}
-#endif
+		if (BoneIndex == INDEX_NONE)
+		{
+			BoneState.ResetLoop(Slot, Subsystem);
+			continue;
+		}
 
-	// Trigger events based on velocity delta
-	if (Delta > ThresholdLoop)
-	{
-		if (!LoopInstance && SoundCueLoop)
+		BoneState.ActiveSlots.Add(Slot);
+
+		// Body slots read the velocity of the bone's body, Custom never gets here
+		int32 BodyIndex = INDEX_NONE;
+		if (Bone.bUseBodyVelocity && Bone.TrackingSpace != ETrackedBoneSpace::World)
 		{
-			return SendEvent(ETrackedBoneEvent::SlowThresholdStart);
+			// Body velocities are world space, nothing gives the component's own motion to take out of them
+			if (bMeshChanged)
+			{
+				UE_LOG(LogPhysicalAudio, Warning, TEXT("%s: tracked bone %s uses its body velocity in Relative space, slot %d tracks its transforms. Use World space."), *GetPathName(), *Bone.BoneName.ToString(), Slot);
+			}
 		}
-	}
-	else if (FMath::IsNearlyEqual(InterpolatedVolume, 0.0f))
-	{
-		if (LoopInstance)
+		else if (Bone.bUseBodyVelocity)
 		{
-			return SendEvent(ETrackedBoneEvent::SlowThresholdStop);
+			UPhysicsAsset const* PhysicsAsset = SktMesh->GetPhysicsAsset();
+			BodyIndex = PhysicsAsset ? PhysicsAsset->FindBodyIndex(Bone.BoneName) : INDEX_NONE;
+
+			if (BodyIndex == INDEX_NONE && bMeshChanged)
+			{
+				UE_LOG(LogPhysicalAudio, Warning, TEXT("%s: tracked bone %s has no physics body, slot %d tracks its transforms."), *GetPathName(), *Bone.BoneName.ToString(), Slot);
+			}
 		}
-	}
 
-	if (TimeSinceLastTrigger >= RetriggerDelay || (bDirectionChangedSinceLastTrigger && TrackingSpace == ETrackedBoneSpace::World))
-	{
-		if (Delta >= ThresholdMedium && Delta < ThresholdHigh && SoundCueMedium)
+		// New body, its filter starts from the velocity it has
+		if (BodyIndex != BoneState.BodyIndices[Slot])
 		{
-			return SendEvent(ETrackedBoneEvent::MediumThreshold);
+			BoneState.BodyIndices[Slot] = BodyIndex;
+			bPrimeTracking = true;
 		}
-		else if (Delta >= ThresholdHigh && SoundCueHigh)
+
+		// Prime newly resolved slots so the first update doesn't see a jump
+		if (BoneIndex != PreviousBoneIndex)
 		{
-			return SendEvent(ETrackedBoneEvent::FastThreshold);
+			BoneState.GetCurrentDeltaFromMesh(Slot, Bone, SktMesh);
+			BoneState.OldPositions[Slot] = BoneState.NewPositions[Slot];
+			BoneState.OldRotations[Slot] = BoneState.NewRotations[Slot];
 		}
 	}
+}
 
-	// Fade in/out and pitch up/down loop layer based on normalized movement delta
-	if (LoopInstance)
-	{
-		float Volume = GetRangeMappedDelta(ThresholdLoop, ThresholdHigh);
+void UPhysicalAudioComponent::SetSignificance(EPhysicalAudioSignificance NewSignificance)
+{
+	if (NewSignificance == Significance)
+		return;
 
-		InterpolatedVolume += (Volume - InterpolatedVolume) * NewDeltaTime * VolumeInterpolatedSpeed;
+	Significance = NewSignificance;
 
-		Controller->OnLoopSoundModulated.Broadcast(LoopInstance, InterpolatedVolume);
+	// Dropped or sleeping slots restart from rest
+	bPrimeTracking = true;
+	PendingDeltaTime = 0.f;
+	PendingFrames = 0;
 
-		LoopInstance->SetVolumeMultiplier(InterpolatedVolume * VolumeMultiplier);
+	if (Significance == EPhysicalAudioSignificance::Dormant)
+	{
+		for (int32 Slot = 0; Slot < BoneState.Num(); ++Slot)
+		{
+			BoneState.ResetLoop(Slot, Subsystem);
+		}
+	}
+	else if (TrackedBones)
+	{
+		// Rebuild the active slots for the new bone set, levels only change past the hysteresis band so this stays rare
+		ResolveBoneIndices(bIsSkeletalMesh ? Cast<USkeletalMeshComponent>(Mesh) : nullptr);
 	}
-
-	return ETrackedBoneEvent::None;
-}
-
-float FTrackedBone::GetRangeMappedDelta(float Left, float Right)
-{
-	FVector2D RangeFrom(Left, Right);
-	FVector2D RangeTo(0.0f, 1.0f);
-	return FMath::GetMappedRangeValueClamped(RangeFrom, RangeTo, Delta);
 }
 
-void FTrackedBone::GetCurrentDeltaFromMesh(USkeletalMeshComponent* Mesh)
+void UPhysicalAudioComponent::Sleep()
 {
-	int32 BoneIndex = Mesh->GetBoneIndex(BoneName);
-	FTransform Transform = Mesh->GetBoneTransform(BoneIndex);
-	FTransform RelTransform = Mesh->GetComponentTransform().GetRelativeTransform(Transform);
+	// Rigid body sleep isn't reproducible, captures keep every component tracked
+	if (bIsAsleep || FPhysicalAudioCapture::Get().IsActive())
+		return;
 
-	// Store previous information
-	OldRotation = NewRotation;
-	OldPosition = NewPosition;
+	bIsAsleep = true;
+	TimeSinceWakeProbe = 0.f;
 
-	// Switch coordinate spaces for tracking current information
-	switch (TrackingSpace)
+	for (int32 Slot = 0; Slot < BoneState.Num(); ++Slot)
 	{
-	case ETrackedBoneSpace::Relative:
-		NewRotation = RelTransform.GetRotation();
-		NewPosition = RelTransform.GetLocation();
-		break;
-	case ETrackedBoneSpace::World:
-		NewRotation = Transform.GetRotation();
-		NewPosition = Transform.GetLocation();
-		break;
+		BoneState.ResetLoop(Slot, Subsystem);
 	}
 }
 
-void FTrackedBone::GetCurrentDeltaFromTransform(FTransform const& Transform)
+void UPhysicalAudioComponent::Wake()
 {
-	// Store previous information
-	OldRotation = NewRotation;
-	OldPosition = NewPosition;
+	QuietUpdates = 0;
 
-	// Update to new information
-	NewRotation = Transform.GetRotation();
-	NewPosition = Transform.GetLocation();
+	if (!bIsAsleep)
+		return;
+
+	bIsAsleep = false;
+
+	// Transforms are from before the sleep
+	bPrimeTracking = true;
+	PendingDeltaTime = 0.f;
+	PendingFrames = 0;
 }
 
-void FTrackedBone::ResetLoop()
+void UPhysicalAudioComponent::ProbeWake(float DeltaTime)
 {
-	if (LoopInstance)
+	if (FPhysicalAudioCapture::Get().IsActive())
 	{
-		LoopInstance->FadeOut(0.5f, 0.0f);
-		LoopInstance = nullptr;
-		InterpolatedVolume = 0.0f;
+		Wake();
+		return;
 	}
-}
 
-ETrackedBoneEvent FTrackedBone::SendEvent(ETrackedBoneEvent Event)
-{
-	switch (Event)
-	{
-	case ETrackedBoneEvent::SlowThresholdStart:
-	case ETrackedBoneEvent::SlowThresholdStop:
-		break;
+	// Custom slots only move when BP sets them, which it does from this broadcast. SetCustomTrackedTransform wakes us.
+	BroadcastCustomTrackedTick(BoneState.ActiveSlots);
+	if (!bIsAsleep)
+		return;
 
-	default:
-		TimeSinceLastTrigger = 0.0f;
-		break;
+	TimeSinceWakeProbe += DeltaTime;
+	if (TimeSinceWakeProbe < CVarPhysicalAudioSleepProbeInterval.GetValueOnGameThread())
+		return;
+
+	TimeSinceWakeProbe = 0.f;
+
+	USkeletalMeshComponent const* SktMesh = bIsSkeletalMesh ? Cast<USkeletalMeshComponent>(Mesh) : nullptr;
+
+	// Custom slots were handled above, only the bodies can tell us something else moved without a wake event
+	if (SktMesh == nullptr)
+	{
+		if (Mesh && Mesh->IsAnyRigidBodyAwake())
+		{
+			Wake();
+		}
+		return;
 	}
 
-	return Event;
+	if (!TrackedBones)
+		return;
+
+	// Animated or simulated alike, wake on any tracked bone that moved
+
+	TArray<FTransform> const& ComponentSpaceTransforms = SktMesh->GetComponentSpaceTransforms();
+	FTransform const& ComponentTransform = SktMesh->GetComponentTransform();
+
+	for (int32 Slot : BoneState.ActiveSlots)
+	{
+		const int32 BoneIndex = BoneState.BoneIndices[Slot];
+		if (!ComponentSpaceTransforms.IsValidIndex(BoneIndex))
+			continue;
+
+		// Compare in the tracked space, with the last position the slot was updated with
+		FTrackedBone const& Bone = (*TrackedBones)[Slot];
+		const FVector Position = Bone.TrackingSpace == ETrackedBoneSpace::World
+			? (ComponentSpaceTransforms[BoneIndex] * ComponentTransform).GetLocation()
+			: ComponentSpaceTransforms[BoneIndex].Inverse().GetLocation();
+
+		if (!Position.Equals(BoneState.NewPositions[Slot], KINDA_SMALL_NUMBER))
+		{
+			Wake();
+			return;
+		}
+	}
 }
 
-FPhysicalAudioData::FPhysicalAudioData()
-	: TrackedBones()
+void UPhysicalAudioComponent::OnMeshSleep(UPrimitiveComponent* SleepingComponent, FName BoneName)
 {
+	// Sent per body, wait for the last one
+	if (Mesh && !Mesh->IsAnyRigidBodyAwake())
+	{
+		Sleep();
+	}
 }
 
-// Sets default values for this component's properties
-UPhysicalAudioComponent::UPhysicalAudioComponent()
+void UPhysicalAudioComponent::OnMeshWake(UPrimitiveComponent* WakingComponent, FName BoneName)
 {
-	// Set this component to be initialized when the game starts, and to be ticked every frame.  You can turn these features
-	// off to improve performance if you don't need them.
-	PrimaryComponentTick.bCanEverTick = true;
-	PrimaryComponentTick.bStartWithTickEnabled = false;
-	PrimaryComponentTick.TickGroup = TG_DuringPhysics;
-
-	bVisible = false; // We don't draw anything (and probably should just be an ActorComponent)
-	bUseAttachParentBound = true; // Avoid CalcBounds() when transform changes.
-	bNeverNeedsRenderUpdate = true;
-
-	bShouldIgnoreDilation = false;
-	bShouldAttachOneShots = false;
-	bCanPlay = false;
-	InterpSpeed = 50;
-	VolumeMultiplier = 1.0f;
+	Wake();
 }
 
-
-// Called when the game starts
-void UPhysicalAudioComponent::BeginPlay()
+void UPhysicalAudioComponent::ScheduleTrackedBones(float ElapsedTime)
 {
-	Super::BeginPlay();
+	BoneState.DueSlots.Reset();
 
-	// Locate parented skeletal mesh component, for tracking Bones and listening for broken constraints
-	Mesh = Cast<USkeletalMeshComponent>(PhysicalUtils::FindFirstParentOfClass(this, USkeletalMeshComponent::StaticClass()));
-	if (Mesh == nullptr)
-	{
-		bIsSkeletalMesh = false;
-		Mesh = Cast<UStaticMeshComponent>(PhysicalUtils::FindFirstParentOfClass(this, UStaticMeshComponent::StaticClass()));
-	}
-	else
+	for (int32 Slot : BoneState.ActiveSlots)
 	{
-		bIsSkeletalMesh = true;
-	}
+		const float Interval = BoneState.UpdateIntervals[Slot];
+		float& PendingTime = BoneState.PendingTimes[Slot];
+		float& TimeSinceSample = BoneState.TimesSinceSample[Slot];
 
-	// We can detach from parent now, since we've cached the mesh reference
-	DetachFromComponent(FDetachmentTransformRules::KeepRelativeTransform);
+		PendingTime += ElapsedTime;
+		TimeSinceSample += ElapsedTime;
 
-	// Fill-out data from table based on Name Ref
-	ResetDataFromTable();
+		// Primed slots all restart together, then fall back on their own phase
+		if (bPrimeTracking)
+		{
+			PendingTime = GetStaggerOffset(Slot);
+		}
+		else if (PendingTime >= Interval)
+		{
+			// Keep the remainder so the rate holds, a hitch drops the missed updates rather than bunching them up
+			PendingTime -= Interval;
+			if (PendingTime >= Interval)
+			{
+				PendingTime = Interval > 0.f ? FMath::Fmod(PendingTime, Interval) : 0.f;
+			}
+		}
+		else
+		{
+			continue;
+		}
+
+		// The filter steps over the real time since the last sample, not the phase
+		BoneState.ElapsedTimes[Slot] = TimeSinceSample;
+		TimeSinceSample = 0.f;
+		BoneState.DueSlots.Add(Slot);
+	}
 }
 
+float UPhysicalAudioComponent::GetStaggerOffset(int32 Slot) const
+{
+	// Golden ratio sequence over slot and component, spreads any number of slots evenly over the interval
+	return BoneState.UpdateIntervals[Slot] * FMath::Frac((Slot + (StaggerSeed & 0xffff)) * 0.618034f);
+}
 
-// Called every frame
-void UPhysicalAudioComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+void UPhysicalAudioComponent::UpdateTrackedBones(USkeletalMeshComponent const* SktMesh, float MaxStep, float TimeScale)
 {
-	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	SCOPE_CYCLE_COUNTER(STAT_PhysicalAudio_UpdateTrackedBones);
 
-	// Warning: we dynamically enable/disable our tick based on bCanPlay (see SetCanPlay)
-	// We must be parented to a skeletal mesh component for Bone information to be read
-	if (bCanPlay && Mesh)
+	BoneState.LinearSlots.Reset();
+	BoneState.RotationalSlots.Reset();
+	BoneState.BodySlots.Reset();
+
+	// Gather: the pose and component transform are read once per mesh, shared by every slot
+	static const TArray<FTransform> EmptyPose;
+	TArray<FTransform> const& ComponentSpaceTransforms = SktMesh ? SktMesh->GetComponentSpaceTransforms() : EmptyPose;
+	FTransform const& ComponentTransform = SktMesh ? SktMesh->GetComponentTransform() : FTransform::Identity;
+
+	for (int32 Slot : BoneState.DueSlots)
 	{
-		// Tick all the tracked Bone objects for this component
-		for (auto &VTS : TrackedBones)
-		{
-			float TimeDilation = UGameplayStatics::GetGlobalTimeDilation(GetWorld());
+		FTrackedBone const& Bone = (*TrackedBones)[Slot];
+		const ETrackedBoneVelocityType VelocityTrackingType = BoneState.VelocityTypes[Slot];
+
+		// Measure time since last sound cue trigger
+		float& ElapsedTime = BoneState.ElapsedTimes[Slot];
+		BoneState.TimesSinceLastTrigger[Slot] += ElapsedTime;
+
+		// Velocity over the real time since the slot's last update, becomes the slot's filter time step
+		ElapsedTime = FMath::Min(ElapsedTime, BoneState.UpdateIntervals[Slot] + MaxStep) * TimeScale;
+
+		BoneState.Deltas[Slot] = 0.f;
 
-			if (VTS.VelocityTrackingType == ETrackedBoneVelocityType::Custom)
+		// Body velocity gathered in PrepareTracking or replayed, no transform history involved
+		if (BoneState.BodyIndices[Slot] != INDEX_NONE)
+		{
+			if (bPrimeTracking)
 			{
-				if (OnCustomTrackedTick.IsBound())
-				{
-					OnCustomTrackedTick.Broadcast(VTS);
-				}
+				BoneState.FilteredForces[Slot] = BoneState.BodyVelocities[Slot];
 			}
 
-#if WITH_EDITORONLY_DATA
-			ETrackedBoneEvent Result = VTS.Update(this, bIsSkeletalMesh ? Cast<USkeletalMeshComponent>(Mesh) : nullptr, DeltaTime, TimeDilation, bShouldIgnoreDilation, InterpSpeed, VolumeMultiplier, bEnableDebug);
-#else
-			ETrackedBoneEvent Result = VTS.Update(bIsSkeletalMesh? Cast<USkeletalMeshComponent>(Mesh): nullptr, DeltaTime, TimeDilation, bShouldIgnoreDilation, InterpSpeed, VolumeMultiplier);
-#endif
-			// Receive events thrown by tracked Bones
-			switch (Result)
-			{
-			case ETrackedBoneEvent::SlowThresholdStart:
-			{
-				VTS.ResetLoop();
-				VTS.LoopInstance = PlaySoundFromBone(VTS, VTS.SoundCueLoop, 0.0f, true);
+			BoneState.BodySlots.Add(Slot);
+			continue;
+		}
 
-				if (OnLoopSoundTriggered.IsBound())
-				{
-					OnLoopSoundTriggered.Broadcast(VTS.LoopInstance);
-				}
-			} break;
+		// Poll current/previous location from actor's Bone, Custom slots were set by BP in PrepareTracking
+		if (VelocityTrackingType != ETrackedBoneVelocityType::Custom && !bReplayingInput)
+		{
+			BoneState.GetCurrentDeltaFromPose(Slot, Bone.TrackingSpace, ComponentSpaceTransforms, ComponentTransform);
+		}
 
-			case ETrackedBoneEvent::SlowThresholdStop:
-				if (VTS.LoopInstance)
-				{
-					VTS.LoopInstance->Stop();
-					VTS.LoopInstance->DestroyComponent();
-					VTS.LoopInstance = nullptr;
-				}
-				break;
+		// Woke up or just became significant, start from rest instead of the stale transforms
+		if (bPrimeTracking)
+		{
+			BoneState.OldPositions[Slot] = BoneState.NewPositions[Slot];
+			BoneState.OldRotations[Slot] = BoneState.NewRotations[Slot];
+			BoneState.FilteredForces[Slot] = FVector::ZeroVector;
+			BoneState.FilteredTorques[Slot] = FQuat(0.f, 0.f, 0.f, 0.f);
+		}
 
-			case ETrackedBoneEvent::MediumThreshold:
-			{
-				// Determine whether or not we need to create an audio component for this one-shot
-				bool bUseAudioComponent = false;
-				if (OnMediumSoundTriggered.IsBound() || bShouldAttachOneShots)
-				{
-					bUseAudioComponent = true;
-				}
+		if (VelocityTrackingType != ETrackedBoneVelocityType::Linear)
+		{
+			BoneState.RotationalSlots.Add(Slot);
+		}
+		if (VelocityTrackingType != ETrackedBoneVelocityType::Rotational)
+		{
+			BoneState.LinearSlots.Add(Slot);
+		}
+	}
 
-				// Trigger sound to play, modulate volume based on intensity of movement delta
-				float Volume = VTS.GetRangeMappedDelta(VTS.ThresholdMedium, VTS.ThresholdHigh);
-				UAudioComponent* MediumSound = PlaySoundFromBone(VTS, VTS.SoundCueMedium, Volume, bUseAudioComponent);
+	// Linear/angular velocity tracking, Custom slots sum both deltas
+	PhysicalAudioKernels::FilterRotational(BoneState.RotationalSlots.GetData(), BoneState.RotationalSlots.Num(),
+		BoneState.OldRotations.GetData(), BoneState.NewRotations.GetData(), BoneState.FilteredTorques.GetData(),
+		BoneState.Deltas.GetData(), BoneState.ElapsedTimes.GetData(), InterpSpeed);
 
-				if (bUseAudioComponent && MediumSound)
-				{
-					OnMediumSoundTriggered.Broadcast(MediumSound, Volume);
-				}
-			} break;
+	PhysicalAudioKernels::FilterLinear(BoneState.LinearSlots.GetData(), BoneState.LinearSlots.Num(),
+		BoneState.OldPositions.GetData(), BoneState.NewPositions.GetData(), BoneState.FilteredForces.GetData(),
+		BoneState.Deltas.GetData(), BoneState.ElapsedTimes.GetData(), InterpSpeed);
 
-			case ETrackedBoneEvent::FastThreshold:
-			{
-				// Determine whether or not we need to create an audio component for this one-shot
-				bool bUseAudioComponent = false;
-				if (OnHeavySoundTriggered.IsBound() || bShouldAttachOneShots)
-				{
-					bUseAudioComponent = true;
-				}
+	PhysicalAudioKernels::FilterMeasured(BoneState.BodySlots.GetData(), BoneState.BodySlots.Num(),
+		BoneState.BodyVelocities.GetData(), BoneState.FilteredForces.GetData(),
+		BoneState.Deltas.GetData(), BoneState.ElapsedTimes.GetData(), InterpSpeed);
 
-				// Trigger sound to play, modulate volume based on intensity of movement delta
-				UAudioComponent* HeavySound = PlaySoundFromBone(VTS, VTS.SoundCueHigh, 1.0f, bUseAudioComponent);
+	bPrimeTracking = false;
 
-				if (bUseAudioComponent && HeavySound)
-				{
-					OnHeavySoundTriggered.Broadcast(HeavySound);
-				}
-			} break;
-			}
+	for (int32 Slot : BoneState.LinearSlots)
+	{
+		if (BoneState.VelocityTypes[Slot] != ETrackedBoneVelocityType::Custom)
+		{
+			continue;
 		}
+
+		// Examine this delta against the previous delta (POSITION ONLY), to see if it's an abrupt change in direction
+		FVector CurrentTriggerVector = BoneState.NewPositions[Slot] - BoneState.OldPositions[Slot];
+		CurrentTriggerVector.Normalize();
+
+		float DotFromLastTrigger = FVector::DotProduct(CurrentTriggerVector, BoneState.PreviousTriggerVectors[Slot]);
+
+		BoneState.DirectionChangedSinceLastTrigger[Slot] = DotFromLastTrigger <= 0.0f && CurrentTriggerVector.Size() >= (*TrackedBones)[Slot].ThresholdMedium / 2.0f;
+
+		BoneState.PreviousTriggerVectors[Slot] = CurrentTriggerVector;
+	}
+
+	PhysicalAudioKernels::BuildThresholdMask(BoneState.Deltas.GetData(), BoneState.ThresholdsLoop.GetData(), BoneState.Num(), BoneState.AboveLoopMask.GetData(), nullptr);
+	PhysicalAudioKernels::BuildThresholdMask(BoneState.Deltas.GetData(), BoneState.ThresholdsMedium.GetData(), BoneState.Num(), nullptr, BoneState.AboveMediumMask.GetData());
+	PhysicalAudioKernels::BuildThresholdMask(BoneState.Deltas.GetData(), BoneState.ThresholdsHigh.GetData(), BoneState.Num(), nullptr, BoneState.AboveHighMask.GetData());
+}
+
+ETrackedBoneEvent UPhysicalAudioComponent::EvaluateTrackedBone(int32 Slot, float NewDeltaTime)
+{
+	FTrackedBone const& Bone = (*TrackedBones)[Slot];
+
+	PhysicalAudioCore::FBoneTriggerInput Input;
+	Input.bAboveLoop = PhysicalAudioKernels::IsMaskBitSet(BoneState.AboveLoopMask.GetData(), Slot);
+	Input.bAboveMedium = PhysicalAudioKernels::IsMaskBitSet(BoneState.AboveMediumMask.GetData(), Slot);
+	Input.bAboveHigh = PhysicalAudioKernels::IsMaskBitSet(BoneState.AboveHighMask.GetData(), Slot);
+	Input.bHasLoopSound = !Bone.SoundCueLoop.IsNull();
+	Input.bHasMediumSound = !Bone.SoundCueMedium.IsNull();
+	Input.bHasHighSound = !Bone.SoundCueHigh.IsNull();
+	Input.bLoopPlaying = BoneState.LoopInstances[Slot] != nullptr;
+	Input.InterpolatedVolume = BoneState.InterpolatedVolumes[Slot];
+	Input.TimeSinceLastTrigger = BoneState.TimesSinceLastTrigger[Slot];
+	Input.RetriggerDelay = Bone.RetriggerDelay;
+	Input.bDirectionChanged = BoneState.DirectionChangedSinceLastTrigger[Slot] && Bone.TrackingSpace == ETrackedBoneSpace::World;
+
+	const ETrackedBoneEvent Event = PhysicalAudioCore::EvaluateThresholds(Input);
+
+	// Fade in/out and pitch up/down loop layer based on normalized movement delta
+	if (Event == ETrackedBoneEvent::LoopModulated)
+	{
+		float& InterpolatedVolume = BoneState.InterpolatedVolumes[Slot];
+		InterpolatedVolume = PhysicalAudioCore::InterpolateLoopVolume(InterpolatedVolume, BoneState.Deltas[Slot], Bone.ThresholdLoop, Bone.ThresholdHigh, NewDeltaTime, Bone.VolumeInterpolatedSpeed);
+	}
+
+	return SendEvent(Slot, Event);
+}
+
+ETrackedBoneEvent UPhysicalAudioComponent::SendEvent(int32 Slot, ETrackedBoneEvent Event)
+{
+	if (PhysicalAudioCore::RestartsRetriggerDelay(Event))
+	{
+		BoneState.TimesSinceLastTrigger[Slot] = 0.0f;
 	}
+
+	return Event;
 }
 
 void UPhysicalAudioComponent::SetCanPlay(bool CanPlay)
@@ -390,32 +1160,36 @@ void UPhysicalAudioComponent::SetCanPlay(bool CanPlay)
 
 	if (!bCanPlay)
 	{
-		for (auto &VTS : TrackedBones)
+		for (int32 Slot = 0; Slot < BoneState.Num(); ++Slot)
 		{
-			VTS.ResetLoop();
+			BoneState.ResetLoop(Slot, Subsystem);
 		}
 
-		PrimaryComponentTick.SetTickFunctionEnable(false);
+		if (Subsystem)
+		{
+			Subsystem->UnregisterComponent(this);
+		}
 	}
 	else
 	{
-		for (auto &VTS : TrackedBones)
+		USkeletalMeshComponent* SktMesh = Cast<USkeletalMeshComponent>(Mesh);
+
+		for (int32 Slot = 0; Slot < BoneState.Num(); ++Slot)
 		{
-			VTS.ResetLoop();
+			BoneState.ResetLoop(Slot, Subsystem);
 
-			if (VTS.VelocityTrackingType != ETrackedBoneVelocityType::Custom)
+			if (SktMesh && BoneState.BoneIndices[Slot] != INDEX_NONE)
 			{
-				USkeletalMeshComponent* SktMesh = Cast<USkeletalMeshComponent>(Mesh);
-				if (SktMesh && SktMesh->GetBoneIndex(VTS.BoneName) != INDEX_NONE)
-				{
-					VTS.GetCurrentDeltaFromMesh(SktMesh);
-				}
+				BoneState.GetCurrentDeltaFromMesh(Slot, (*TrackedBones)[Slot], SktMesh);
 			}
 		}
 
-		if (!PrimaryComponentTick.IsTickFunctionEnabled())
+		// Transforms were just primed above
+		Wake();
+
+		if (UPhysicalAudioSubsystem* PhysicalAudioSubsystem = GetSubsystem())
 		{
-			PrimaryComponentTick.SetTickFunctionEnable(true);
+			PhysicalAudioSubsystem->RegisterComponent(this);
 		}
 	}
 }
@@ -427,16 +1201,49 @@ void UPhysicalAudioComponent::SetVolumeMultiplier(float Multiplier)
 
 void UPhysicalAudioComponent::SetCustomTrackedTransform(int32 Index, FTransform const& Transform)
 {
-	if (Index >= 0 && Index < TrackedBones.Num())
+	if (Index >= 0 && Index < BoneState.Num())
 	{
-		TrackedBones[Index].GetCurrentDeltaFromTransform(Transform);
+		// Custom slots have no body or bone to wake us, moving one does
+		const FVector Location = Transform.GetLocation();
+		const FQuat Rotation = Transform.GetRotation();
+		if (PhysicalAudioCore::ShouldWakeOnCustomTransform(bIsAsleep, &BoneState.NewPositions[Index].X, &BoneState.NewRotations[Index].X, &Location.X, &Rotation.X, KINDA_SMALL_NUMBER))
+		{
+			Wake();
+		}
+
+		BoneState.GetCurrentDeltaFromTransform(Index, Transform);
 	}
 }
 
-UAudioComponent* UPhysicalAudioComponent::PlaySoundFromBone(FTrackedBone const& VTS, USoundBase* Sound, float Volume, bool UseAttachedAudioComponent /*= false*/)
+float UPhysicalAudioComponent::GetTrackedBoneDelta(int32 Index) const
+{
+	return BoneState.Deltas.IsValidIndex(Index) ? BoneState.Deltas[Index] : 0.f;
+}
+
+TArray<FTrackedBone> UPhysicalAudioComponent::GetTrackedBones() const
+{
+	return TrackedBones ? *TrackedBones : TArray<FTrackedBone>();
+}
+
+UAudioComponent* UPhysicalAudioComponent::PlaySoundFromBone(int32 Slot, const TAssetPtr<USoundBase>& SoundAsset, float Volume, bool UseAttachedAudioComponent /*= false*/, bool bPooled /*= true*/)
 {
+	SCOPE_CYCLE_COUNTER(STAT_PhysicalAudio_PlaySoundFromBone);
+
+	FTrackedBone const& VTS = (*TrackedBones)[Slot];
+
+	USoundBase* Sound = FPhysicalAudioPresetRegistry::Get().GetLoadedSound(SoundAsset);
+	if (Sound == nullptr)
+	{
+		return nullptr;
+	}
+
 	if (UseAttachedAudioComponent)
 	{
+		if (Subsystem && bPooled)
+		{
+			return Subsystem->AcquireAudioComponent(Sound, Mesh, VTS.BoneName, Volume * VolumeMultiplier);
+		}
+
 		return UGameplayStatics::SpawnSoundAttached(
 			Sound,
 			Mesh,
@@ -449,7 +1256,7 @@ UAudioComponent* UPhysicalAudioComponent::PlaySoundFromBone(FTrackedBone const&
 	}
 	else if (Mesh)
 	{
-		FVector Location = Mesh->GetSocketLocation(VTS.BoneName);
+		FVector Location = GetSlotLocation(Slot);
 
 		UGameplayStatics::PlaySoundAtLocation(this, Sound, Location);
 
@@ -459,23 +1266,54 @@ UAudioComponent* UPhysicalAudioComponent::PlaySoundFromBone(FTrackedBone const&
 	return nullptr;
 }
 
+float UPhysicalAudioComponent::GetMaxAudibleDistance() const
+{
+	return Preset.IsValid() ? Preset->MaxAudibleDistance : 0.f;
+}
+
+UPhysicalAudioSubsystem* UPhysicalAudioComponent::GetSubsystem()
+{
+	if (Subsystem == nullptr)
+	{
+		Subsystem = UPhysicalAudioSubsystem::Get(GetWorld());
+	}
+
+	return Subsystem;
+}
+
 void UPhysicalAudioComponent::ResetDataFromTable()
 {
-	if (DataTableAsset)
+	TrackedBones = nullptr;
+	BoneState.Reset(0);
+
+	// Config is shared with every component on the same row, only the simulation state is per instance
+	Preset = FPhysicalAudioPresetRegistry::Get().FindBonePreset(DataTableAsset, DataNameRef);
+
+	if (Preset.IsValid())
 	{
-		static const FString ContextStr(TEXT("GetPhysicalAudioData"));
-		FPhysicalAudioData const* Data = DataTableAsset->FindRow<FPhysicalAudioData>(DataNameRef, ContextStr);
+		TrackedBones = &Preset->TrackedBones;
+		BoneState.Reset(TrackedBones->Num());
 
-		if (Data)
+		for (int32 Slot = 0; Slot < BoneState.Num(); ++Slot)
 		{
-			TrackedBones = Data->TrackedBones;
+			FTrackedBone const& Bone = (*TrackedBones)[Slot];
 
-			for (auto& Bone : TrackedBones)
-			{
-				Bone.Controller = this;
+			BoneState.VelocityTypes[Slot] = bIsSkeletalMesh ? Bone.VelocityTrackingType : ETrackedBoneVelocityType::Custom;
+			BoneState.ThresholdsLoop[Slot] = Bone.ThresholdLoop;
+			BoneState.ThresholdsMedium[Slot] = Bone.ThresholdMedium;
+			BoneState.ThresholdsHigh[Slot] = Bone.ThresholdHigh;
 
-				if (!bIsSkeletalMesh) Bone.VelocityTrackingType = ETrackedBoneVelocityType::Custom;
-			}
+			BoneState.UpdateIntervals[Slot] = Bone.UpdateRate > 0.f ? 1.f / Bone.UpdateRate : 0.f;
+			BoneState.PendingTimes[Slot] = GetStaggerOffset(Slot);
 		}
 	}
-}
\ No newline at end of file
+
+	UpdateTrackedStateMemory();
+}
+
+void UPhysicalAudioComponent::UpdateTrackedStateMemory()
+{
+	DEC_MEMORY_STAT_BY(STAT_PhysicalAudio_TrackedStateMemory, TrackedStateMemory);
+	TrackedStateMemory = BoneState.GetAllocatedSize();
+	INC_MEMORY_STAT_BY(STAT_PhysicalAudio_TrackedStateMemory, TrackedStateMemory);
+}
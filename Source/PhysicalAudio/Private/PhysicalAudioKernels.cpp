@@ -0,0 +1,287 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicalAudio.h"
+#include "PhysicalAudioKernels.h"
+#include "PhysicalAudioCore.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<int32> CVarPhysicalAudioSimdKernel(
+	TEXT("pa.Tracking.SimdKernel"),
+	1,
+	TEXT("0: filter tracked bone velocities with the scalar reference kernel.\n")
+	TEXT("1: filter tracked bone velocities with the vectorized kernel (default)."),
+	ECVF_Default);
+
+#if !UE_BUILD_SHIPPING
+static TAutoConsoleVariable<int32> CVarPhysicalAudioValidateSimdKernel(
+	TEXT("pa.Tracking.ValidateSimdKernel"),
+	0,
+	TEXT("1: run the scalar reference next to the vectorized kernel and log mismatches."),
+	ECVF_Cheat);
+#endif
+
+namespace PhysicalAudioKernels
+{
+	/*
+	* Rows of four floats to columns, lane N of column C being component C of row N. Its own inverse.
+	* @Rows and @Columns may be the same array.
+	*/
+	static FORCEINLINE void Transpose4(const VectorRegister* Rows, VectorRegister* Columns)
+	{
+		// (x0, y0, x1, y1), (z0, w0, z1, w1), same for rows 2 and 3
+		const VectorRegister Low01 = VectorShuffle(Rows[0], Rows[1], 0, 1, 0, 1);
+		const VectorRegister High01 = VectorShuffle(Rows[0], Rows[1], 2, 3, 2, 3);
+		const VectorRegister Low23 = VectorShuffle(Rows[2], Rows[3], 0, 1, 0, 1);
+		const VectorRegister High23 = VectorShuffle(Rows[2], Rows[3], 2, 3, 2, 3);
+
+		Columns[0] = VectorShuffle(Low01, Low23, 0, 2, 0, 2);
+		Columns[1] = VectorShuffle(Low01, Low23, 1, 3, 1, 3);
+		Columns[2] = VectorShuffle(High01, High23, 0, 2, 0, 2);
+		Columns[3] = VectorShuffle(High01, High23, 1, 3, 1, 3);
+	}
+
+	static FORCEINLINE VectorRegister LoadRow(const FQuat& Value) { return VectorLoad(&Value); }
+	static FORCEINLINE VectorRegister LoadRow(const FVector& Value) { return VectorLoadFloat3_W0(&Value); }
+	static FORCEINLINE void StoreRow(const VectorRegister& Row, FQuat& Value) { VectorStore(Row, &Value); }
+	static FORCEINLINE void StoreRow(const VectorRegister& Row, FVector& Value) { VectorStoreFloat3(Row, &Value); }
+
+	/* Square roots of the squared sizes of four slots, one per lane, added to their deltas. */
+	static FORCEINLINE void AccumulateSizes(const VectorRegister& SizesSquared, const int32* Slots, float* InOutDeltas)
+	{
+		// sqrt(x) = x * rsqrt(x) for the four lanes at once, the floor keeps a zero size at zero instead of 0 * inf
+		const VectorRegister Sizes = VectorMultiply(SizesSquared, VectorReciprocalSqrtAccurate(VectorMax(SizesSquared, VectorSetFloat1(1.e-30f))));
+		const VectorRegister Deltas = MakeVectorRegister(InOutDeltas[Slots[0]], InOutDeltas[Slots[1]], InOutDeltas[Slots[2]], InOutDeltas[Slots[3]]);
+
+		MS_ALIGN(16) float Accumulated[4] GCC_ALIGN(16);
+		VectorStoreAligned(VectorAdd(Deltas, Sizes), Accumulated);
+
+		InOutDeltas[Slots[0]] = Accumulated[0];
+		InOutDeltas[Slots[1]] = Accumulated[1];
+		InOutDeltas[Slots[2]] = Accumulated[2];
+		InOutDeltas[Slots[3]] = Accumulated[3];
+	}
+
+	/*
+	* Four slots per iteration, one lane each. The values are stored per slot and the slot lists are sparse, so each
+	* slot is loaded as a row and four rows are transposed into one register per component. The filter then runs on
+	* whole registers and the filtered rows are transposed back.
+	*/
+	template<typename ValueType, typename ScalarKernelType>
+	static void FilterSimd(const int32* Slots, int32 NumSlots, const ValueType* OldValues, const ValueType* NewValues, ValueType* FilteredValues, float* InOutDeltas, const float* DeltaTimes, float InterpSpeed, ScalarKernelType ScalarKernel)
+	{
+		// 3 for positions, 4 for rotations
+		const int32 NumComponents = sizeof(ValueType) / sizeof(float);
+		const VectorRegister InterpSpeedVector = VectorSetFloat1(InterpSpeed);
+
+		int32 Index = 0;
+		for (; Index + 4 <= NumSlots; Index += 4)
+		{
+			const int32* LaneSlots = Slots + Index;
+
+			VectorRegister Old[4], New[4], Filtered[4];
+			for (int32 Lane = 0; Lane < 4; ++Lane)
+			{
+				const int32 Slot = LaneSlots[Lane];
+				Old[Lane] = LoadRow(OldValues[Slot]);
+				New[Lane] = LoadRow(NewValues[Slot]);
+				Filtered[Lane] = LoadRow(FilteredValues[Slot]);
+			}
+
+			Transpose4(Old, Old);
+			Transpose4(New, New);
+			Transpose4(Filtered, Filtered);
+
+			const float DeltaTime0 = DeltaTimes[LaneSlots[0]];
+			const float DeltaTime1 = DeltaTimes[LaneSlots[1]];
+			const float DeltaTime2 = DeltaTimes[LaneSlots[2]];
+			const float DeltaTime3 = DeltaTimes[LaneSlots[3]];
+			const VectorRegister InvDeltaTime = MakeVectorRegister(1.f / DeltaTime0, 1.f / DeltaTime1, 1.f / DeltaTime2, 1.f / DeltaTime3);
+			const VectorRegister Blend = VectorMultiply(MakeVectorRegister(DeltaTime0, DeltaTime1, DeltaTime2, DeltaTime3), InterpSpeedVector);
+
+			VectorRegister SizesSquared = VectorZero();
+			for (int32 Component = 0; Component < NumComponents; ++Component)
+			{
+				const VectorRegister Velocity = VectorMultiply(VectorSubtract(New[Component], Old[Component]), InvDeltaTime);
+				const VectorRegister Delta = VectorSubtract(Velocity, Filtered[Component]);
+
+				Filtered[Component] = VectorMultiplyAdd(Delta, Blend, Filtered[Component]);
+				SizesSquared = VectorMultiplyAdd(Delta, Delta, SizesSquared);
+			}
+
+			Transpose4(Filtered, Filtered);
+			for (int32 Lane = 0; Lane < 4; ++Lane)
+			{
+				StoreRow(Filtered[Lane], FilteredValues[LaneSlots[Lane]]);
+			}
+
+			AccumulateSizes(SizesSquared, LaneSlots, InOutDeltas);
+		}
+
+		ScalarKernel(Slots + Index, NumSlots - Index, OldValues, NewValues, FilteredValues, InOutDeltas, DeltaTimes, InterpSpeed);
+	}
+
+	static void FilterRotationalSimd(const int32* Slots, int32 NumSlots, const FQuat* OldRotations, const FQuat* NewRotations, FQuat* FilteredTorques, float* InOutDeltas, const float* DeltaTimes, float InterpSpeed)
+	{
+		FilterSimd(Slots, NumSlots, OldRotations, NewRotations, FilteredTorques, InOutDeltas, DeltaTimes, InterpSpeed, &FilterRotationalScalar);
+	}
+
+	static void FilterLinearSimd(const int32* Slots, int32 NumSlots, const FVector* OldPositions, const FVector* NewPositions, FVector* FilteredForces, float* InOutDeltas, const float* DeltaTimes, float InterpSpeed)
+	{
+		FilterSimd(Slots, NumSlots, OldPositions, NewPositions, FilteredForces, InOutDeltas, DeltaTimes, InterpSpeed, &FilterLinearScalar);
+	}
+
+#if !UE_BUILD_SHIPPING
+	template<typename ValueType, typename KernelType, typename ReferenceType>
+	static void RunValidated(const TCHAR* KernelName, const int32* Slots, int32 NumSlots, const ValueType* OldValues, const ValueType* NewValues, ValueType* FilteredValues, float* InOutDeltas, const float* DeltaTimes, float InterpSpeed, KernelType Kernel, ReferenceType Reference)
+	{
+		// Compact copy of the touched slots for the reference
+		TArray<int32> CompactSlots;
+		TArray<ValueType> OldCopy, NewCopy, FilteredCopy;
+		TArray<float> DeltasCopy, DeltaTimesCopy;
+		for (int32 Index = 0; Index < NumSlots; ++Index)
+		{
+			CompactSlots.Add(Index);
+			OldCopy.Add(OldValues[Slots[Index]]);
+			NewCopy.Add(NewValues[Slots[Index]]);
+			FilteredCopy.Add(FilteredValues[Slots[Index]]);
+			DeltasCopy.Add(InOutDeltas[Slots[Index]]);
+			DeltaTimesCopy.Add(DeltaTimes[Slots[Index]]);
+		}
+
+		Reference(CompactSlots.GetData(), NumSlots, OldCopy.GetData(), NewCopy.GetData(), FilteredCopy.GetData(), DeltasCopy.GetData(), DeltaTimesCopy.GetData(), InterpSpeed);
+		Kernel(Slots, NumSlots, OldValues, NewValues, FilteredValues, InOutDeltas, DeltaTimes, InterpSpeed);
+
+		for (int32 Index = 0; Index < NumSlots; ++Index)
+		{
+			const float Expected = DeltasCopy[Index];
+			const float Actual = InOutDeltas[Slots[Index]];
+			if (!FMath::IsNearlyEqual(Expected, Actual, KINDA_SMALL_NUMBER + FMath::Abs(Expected) * 1.e-4f))
+			{
+				UE_LOG(LogPhysicalAudio, Warning, TEXT("%s kernel mismatch at slot %d: expected %f, got %f"), KernelName, Slots[Index], Expected, Actual);
+			}
+		}
+	}
+#endif
+
+	void FilterRotational(const int32* Slots, int32 NumSlots, const FQuat* OldRotations, const FQuat* NewRotations, FQuat* FilteredTorques, float* InOutDeltas, const float* DeltaTimes, float InterpSpeed)
+	{
+		if (!UseSimdKernels())
+		{
+			FilterRotationalScalar(Slots, NumSlots, OldRotations, NewRotations, FilteredTorques, InOutDeltas, DeltaTimes, InterpSpeed);
+			return;
+		}
+
+#if !UE_BUILD_SHIPPING
+		if (CVarPhysicalAudioValidateSimdKernel.GetValueOnAnyThread() != 0)
+		{
+			RunValidated(TEXT("Rotational"), Slots, NumSlots, OldRotations, NewRotations, FilteredTorques, InOutDeltas, DeltaTimes, InterpSpeed, &FilterRotationalSimd, &FilterRotationalScalar);
+			return;
+		}
+#endif
+
+		FilterRotationalSimd(Slots, NumSlots, OldRotations, NewRotations, FilteredTorques, InOutDeltas, DeltaTimes, InterpSpeed);
+	}
+
+	void FilterRotationalScalar(const int32* Slots, int32 NumSlots, const FQuat* OldRotations, const FQuat* NewRotations, FQuat* FilteredTorques, float* InOutDeltas, const float* DeltaTimes, float InterpSpeed)
+	{
+		for (int32 Index = 0; Index < NumSlots; ++Index)
+		{
+			const int32 Slot = Slots[Index];
+			const float DeltaTime = DeltaTimes[Slot];
+
+			// Calculate and interpolate to new torque
+			InOutDeltas[Slot] += PhysicalAudioCore::FilterVelocity(&OldRotations[Slot].X, &NewRotations[Slot].X, &FilteredTorques[Slot].X, 4, DeltaTime, InterpSpeed);
+		}
+	}
+
+	void FilterLinear(const int32* Slots, int32 NumSlots, const FVector* OldPositions, const FVector* NewPositions, FVector* FilteredForces, float* InOutDeltas, const float* DeltaTimes, float InterpSpeed)
+	{
+		if (!UseSimdKernels())
+		{
+			FilterLinearScalar(Slots, NumSlots, OldPositions, NewPositions, FilteredForces, InOutDeltas, DeltaTimes, InterpSpeed);
+			return;
+		}
+
+#if !UE_BUILD_SHIPPING
+		if (CVarPhysicalAudioValidateSimdKernel.GetValueOnAnyThread() != 0)
+		{
+			RunValidated(TEXT("Linear"), Slots, NumSlots, OldPositions, NewPositions, FilteredForces, InOutDeltas, DeltaTimes, InterpSpeed, &FilterLinearSimd, &FilterLinearScalar);
+			return;
+		}
+#endif
+
+		FilterLinearSimd(Slots, NumSlots, OldPositions, NewPositions, FilteredForces, InOutDeltas, DeltaTimes, InterpSpeed);
+	}
+
+	void FilterLinearScalar(const int32* Slots, int32 NumSlots, const FVector* OldPositions, const FVector* NewPositions, FVector* FilteredForces, float* InOutDeltas, const float* DeltaTimes, float InterpSpeed)
+	{
+		for (int32 Index = 0; Index < NumSlots; ++Index)
+		{
+			const int32 Slot = Slots[Index];
+			const float DeltaTime = DeltaTimes[Slot];
+
+			// Calculate and interpolate to new velocity
+			InOutDeltas[Slot] += PhysicalAudioCore::FilterVelocity(&OldPositions[Slot].X, &NewPositions[Slot].X, &FilteredForces[Slot].X, 3, DeltaTime, InterpSpeed);
+		}
+	}
+
+	void FilterMeasured(const int32* Slots, int32 NumSlots, const FVector* Velocities, FVector* FilteredVelocities, float* InOutDeltas, const float* DeltaTimes, float InterpSpeed)
+	{
+		for (int32 Index = 0; Index < NumSlots; ++Index)
+		{
+			const int32 Slot = Slots[Index];
+			InOutDeltas[Slot] += PhysicalAudioCore::FilterMeasuredVelocity(&Velocities[Slot].X, &FilteredVelocities[Slot].X, 3, DeltaTimes[Slot], InterpSpeed);
+		}
+	}
+
+	void BuildThresholdMask(const float* Deltas, const float* Thresholds, int32 Num, uint32* OutGreater, uint32* OutGreaterEqual)
+	{
+		const int32 NumWords = GetNumMaskWords(Num);
+		if (OutGreater)
+		{
+			FMemory::Memzero(OutGreater, NumWords * sizeof(uint32));
+		}
+		if (OutGreaterEqual)
+		{
+			FMemory::Memzero(OutGreaterEqual, NumWords * sizeof(uint32));
+		}
+
+		int32 Index = 0;
+		if (UseSimdKernels())
+		{
+			for (; Index + 4 <= Num; Index += 4)
+			{
+				const VectorRegister Delta = VectorLoad(&Deltas[Index]);
+				const VectorRegister Threshold = VectorLoad(&Thresholds[Index]);
+
+				// Index is a multiple of 4, the four bits never straddle two words
+				if (OutGreater)
+				{
+					OutGreater[Index >> 5] |= uint32(VectorMaskBits(VectorCompareGT(Delta, Threshold))) << (Index & 31);
+				}
+				if (OutGreaterEqual)
+				{
+					OutGreaterEqual[Index >> 5] |= uint32(VectorMaskBits(VectorCompareGE(Delta, Threshold))) << (Index & 31);
+				}
+			}
+		}
+
+		for (; Index < Num; ++Index)
+		{
+			const uint32 Bit = 1u << (Index & 31);
+			if (OutGreater && Deltas[Index] > Thresholds[Index])
+			{
+				OutGreater[Index >> 5] |= Bit;
+			}
+			if (OutGreaterEqual && Deltas[Index] >= Thresholds[Index])
+			{
+				OutGreaterEqual[Index >> 5] |= Bit;
+			}
+		}
+	}
+
+	bool UseSimdKernels()
+	{
+		return CVarPhysicalAudioSimdKernel.GetValueOnAnyThread() != 0;
+	}
+}
@@ -0,0 +1,37 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+/**
+ * Batch velocity filtering of tracked bones.
+ * Bones are addressed through slot lists, every kernel has a scalar reference used for validation
+ * built on PhysicalAudioCore::FilterVelocity.
+ */
+namespace PhysicalAudioKernels
+{
+	/*
+	* Rotational filter: Torque = (New - Old) / DeltaTime, Filtered += (Torque - Filtered) * DeltaTime * InterpSpeed.
+	* Adds the pre-filter delta size to InOutDeltas of every slot, DeltaTimes holds the time step of every slot.
+	*/
+	void FilterRotational(const int32* Slots, int32 NumSlots, const FQuat* OldRotations, const FQuat* NewRotations, FQuat* FilteredTorques, float* InOutDeltas, const float* DeltaTimes, float InterpSpeed);
+	void FilterRotationalScalar(const int32* Slots, int32 NumSlots, const FQuat* OldRotations, const FQuat* NewRotations, FQuat* FilteredTorques, float* InOutDeltas, const float* DeltaTimes, float InterpSpeed);
+
+	/* Linear filter, same as FilterRotational on positions. */
+	void FilterLinear(const int32* Slots, int32 NumSlots, const FVector* OldPositions, const FVector* NewPositions, FVector* FilteredForces, float* InOutDeltas, const float* DeltaTimes, float InterpSpeed);
+	void FilterLinearScalar(const int32* Slots, int32 NumSlots, const FVector* OldPositions, const FVector* NewPositions, FVector* FilteredForces, float* InOutDeltas, const float* DeltaTimes, float InterpSpeed);
+
+	/* Filter of velocities read from physics bodies, Filtered += (Velocity - Filtered) * DeltaTime * InterpSpeed. Scalar only. */
+	void FilterMeasured(const int32* Slots, int32 NumSlots, const FVector* Velocities, FVector* FilteredVelocities, float* InOutDeltas, const float* DeltaTimes, float InterpSpeed);
+
+	/*
+	* Threshold crossing bitmasks, one bit per slot packed in 32 bit words.
+	* @OutGreater: Deltas[i] > Thresholds[i], @OutGreaterEqual: Deltas[i] >= Thresholds[i]. Either may be null.
+	*/
+	void BuildThresholdMask(const float* Deltas, const float* Thresholds, int32 Num, uint32* OutGreater, uint32* OutGreaterEqual);
+
+	FORCEINLINE int32 GetNumMaskWords(int32 Num) { return (Num + 31) / 32; }
+	FORCEINLINE bool IsMaskBitSet(const uint32* Mask, int32 Index) { return (Mask[Index >> 5] & (1u << (Index & 31))) != 0; }
+
+	/* Whether the vectorized kernels are in use, see pa.Tracking.SimdKernel. */
+	bool UseSimdKernels();
+}
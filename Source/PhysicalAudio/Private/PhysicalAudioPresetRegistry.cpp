@@ -0,0 +1,243 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicalAudio.h"
+#include "PhysicalAudioPresetRegistry.h"
+#include "Engine/DataTable.h"
+#include "Sound/SoundBase.h"
+
+FPhysicalAudioPresetRegistry* FPhysicalAudioPresetRegistry::Instance = nullptr;
+
+FPhysicalAudioPresetRegistry& FPhysicalAudioPresetRegistry::Get()
+{
+	check(Instance);
+	return *Instance;
+}
+
+TSharedPtr<const FPhysicalAudioBonePreset> FPhysicalAudioPresetRegistry::FindBonePreset(UDataTable* DataTable, FName RowName)
+{
+	if (DataTable == nullptr)
+	{
+		return nullptr;
+	}
+
+	const FPresetKey Key(DataTable, RowName);
+	if (TWeakPtr<const FPhysicalAudioBonePreset>* Existing = BonePresets.Find(Key))
+	{
+		TSharedPtr<const FPhysicalAudioBonePreset> Preset = Existing->Pin();
+		if (Preset.IsValid())
+		{
+			return Preset;
+		}
+	}
+
+	static const FString ContextStr(TEXT("FindBonePreset"));
+	FPhysicalAudioData const* Data = DataTable->FindRow<FPhysicalAudioData>(RowName, ContextStr);
+	if (Data == nullptr)
+	{
+		return nullptr;
+	}
+
+	PurgeReleased();
+
+	TSharedRef<FPhysicalAudioBonePreset> Preset = MakeShareable(new FPhysicalAudioBonePreset(), &FPhysicalAudioPresetRegistry::DestroyBonePreset);
+	Preset->TrackedBones = Data->TrackedBones;
+	Preset->bAllBonesImportant = !Data->TrackedBones.ContainsByPredicate([](FTrackedBone const& Bone) { return Bone.bImportant; });
+	Preset->MaxAudibleDistance = WORLD_MAX;
+	Preset->LoopVolumeDeadband = Data->LoopVolumeDeadband;
+	Preset->LoopUpdateInterval = Data->LoopUpdateRate > 0.f ? 1.f / Data->LoopUpdateRate : 0.f;
+
+	for (FTrackedBone const& Bone : Preset->TrackedBones)
+	{
+		for (const TAssetPtr<USoundBase>* Sound : { &Bone.SoundCueLoop, &Bone.SoundCueMedium, &Bone.SoundCueHigh })
+		{
+			if (!Sound->IsNull())
+			{
+				Preset->SoundPaths.AddUnique(Sound->ToStringReference());
+			}
+		}
+	}
+
+	// Significance is ranked against the farthest any of the sounds can be heard, known once they are in
+	TWeakPtr<FPhysicalAudioBonePreset> WeakPreset = Preset;
+	AcquireSounds(Preset->SoundPaths, FStreamableDelegate::CreateLambda([WeakPreset]()
+	{
+		TSharedPtr<FPhysicalAudioBonePreset> LoadedPreset = WeakPreset.Pin();
+		if (!LoadedPreset.IsValid())
+		{
+			return;
+		}
+
+		// Sounds without attenuation report WORLD_MAX, or 0 when the sound class doesn't know, neither one bounds the distance
+		float MaxAttenuatedDistance = 0.f;
+		for (FTrackedBone const& Bone : LoadedPreset->TrackedBones)
+		{
+			for (const TAssetPtr<USoundBase>* Sound : { &Bone.SoundCueLoop, &Bone.SoundCueMedium, &Bone.SoundCueHigh })
+			{
+				if (USoundBase* LoadedSound = Sound->Get())
+				{
+					const float Distance = LoadedSound->GetMaxAudibleDistance();
+					if (Distance > 0.f && Distance < WORLD_MAX)
+					{
+						MaxAttenuatedDistance = FMath::Max(MaxAttenuatedDistance, Distance);
+					}
+				}
+			}
+		}
+		LoadedPreset->MaxAudibleDistance = MaxAttenuatedDistance > 0.f ? MaxAttenuatedDistance : WORLD_MAX;
+	}));
+
+	BonePresets.Add(Key, Preset);
+	return Preset;
+}
+
+TSharedPtr<const FCollisionAudioPreset> FPhysicalAudioPresetRegistry::FindImpactPreset(UDataTable* DataTable, FName RowName)
+{
+	if (DataTable == nullptr)
+	{
+		return nullptr;
+	}
+
+	const FPresetKey Key(DataTable, RowName);
+	if (TWeakPtr<const FCollisionAudioPreset>* Existing = ImpactPresets.Find(Key))
+	{
+		TSharedPtr<const FCollisionAudioPreset> Preset = Existing->Pin();
+		if (Preset.IsValid())
+		{
+			return Preset;
+		}
+	}
+
+	static const FString ContextStr(TEXT("FindImpactPreset"));
+	FCollisionAudioImpactData const* Data = DataTable->FindRow<FCollisionAudioImpactData>(RowName, ContextStr);
+	if (Data == nullptr)
+	{
+		return nullptr;
+	}
+
+	PurgeReleased();
+
+	TSharedRef<FCollisionAudioPreset> Preset = MakeShareable(new FCollisionAudioPreset(), &FPhysicalAudioPresetRegistry::DestroyImpactPreset);
+	Preset->ImpactData = *Data;
+
+	for (const TAssetPtr<USoundBase>* Sound : { &Data->SoundDefault, &Data->SoundHeavy })
+	{
+		if (!Sound->IsNull())
+		{
+			Preset->SoundPaths.AddUnique(Sound->ToStringReference());
+		}
+	}
+
+	AcquireSounds(Preset->SoundPaths, FStreamableDelegate());
+
+	// Rubble of the same impact row landing together merges into one voice
+	Preset->ClusterId = HashCombine(GetTypeHash(RowName), PointerHash(DataTable)) | 1;
+
+	ImpactPresets.Add(Key, Preset);
+	return Preset;
+}
+
+void FPhysicalAudioPresetRegistry::PurgeReleased()
+{
+	for (auto It = BonePresets.CreateIterator(); It; ++It)
+	{
+		if (!It.Value().IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	for (auto It = ImpactPresets.CreateIterator(); It; ++It)
+	{
+		if (!It.Value().IsValid())
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+USoundBase* FPhysicalAudioPresetRegistry::GetLoadedSound(const TAssetPtr<USoundBase>& Sound)
+{
+	USoundBase* LoadedSound = Sound.Get();
+	if (LoadedSound == nullptr && !Sound.IsNull())
+	{
+		const FStringAssetReference& SoundPath = Sound.ToStringReference();
+		if (!StreamableManager.IsAsyncLoadComplete(SoundPath))
+		{
+			UE_LOG(LogPhysicalAudio, Verbose, TEXT("%s is still streaming in, skipped."), *SoundPath.ToString());
+		}
+		else if (!MissingSounds.Contains(SoundPath))
+		{
+			MissingSounds.Add(SoundPath);
+			UE_LOG(LogPhysicalAudio, Warning, TEXT("%s failed to load, its events won't play."), *SoundPath.ToString());
+		}
+	}
+
+	return LoadedSound;
+}
+
+void FPhysicalAudioPresetRegistry::AcquireSounds(const TArray<FStringAssetReference>& SoundPaths, FStreamableDelegate OnLoaded)
+{
+	for (const FStringAssetReference& SoundPath : SoundPaths)
+	{
+		++SoundRefCounts.FindOrAdd(SoundPath);
+	}
+
+	if (SoundPaths.Num() > 0)
+	{
+		// Loaded sounds complete right away
+		StreamableManager.RequestAsyncLoad(SoundPaths, OnLoaded);
+	}
+}
+
+void FPhysicalAudioPresetRegistry::ReleaseSounds(const TArray<FStringAssetReference>& SoundPaths)
+{
+	for (const FStringAssetReference& SoundPath : SoundPaths)
+	{
+		int32* RefCount = SoundRefCounts.Find(SoundPath);
+		if (RefCount && --(*RefCount) <= 0)
+		{
+			SoundRefCounts.Remove(SoundPath);
+			MissingSounds.Remove(SoundPath);
+			StreamableManager.Unload(SoundPath);
+		}
+	}
+}
+
+void FPhysicalAudioPresetRegistry::DestroyBonePreset(FPhysicalAudioBonePreset* Preset)
+{
+	// The registry and its streamable manager are already gone when released after shutdown
+	if (Instance)
+	{
+		Instance->ReleaseSounds(Preset->SoundPaths);
+	}
+	delete Preset;
+}
+
+void FPhysicalAudioPresetRegistry::DestroyImpactPreset(FCollisionAudioPreset* Preset)
+{
+	if (Instance)
+	{
+		Instance->ReleaseSounds(Preset->SoundPaths);
+	}
+	delete Preset;
+}
+
+void FPhysicalAudioPresetRegistry::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	// Sounds are held by the streamable manager, only the tables of live presets are referenced here
+	for (auto& Pair : BonePresets)
+	{
+		if (Pair.Value.IsValid())
+		{
+			Collector.AddReferencedObject(Pair.Key.DataTable);
+		}
+	}
+
+	for (auto& Pair : ImpactPresets)
+	{
+		if (Pair.Value.IsValid())
+		{
+			Collector.AddReferencedObject(Pair.Key.DataTable);
+		}
+	}
+}
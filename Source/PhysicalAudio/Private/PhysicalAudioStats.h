@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Stats/Stats.h"
+
+/* Hot path stats of the plugin, see "stat PhysicalAudio". */
+DECLARE_STATS_GROUP(TEXT("PhysicalAudio"), STATGROUP_PhysicalAudio, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Tick"), STAT_PhysicalAudio_Tick, STATGROUP_PhysicalAudio, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Flush"), STAT_PhysicalAudio_Flush, STATGROUP_PhysicalAudio, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Update Tracked Bones"), STAT_PhysicalAudio_UpdateTrackedBones, STATGROUP_PhysicalAudio, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Apply Tracking Events"), STAT_PhysicalAudio_ApplyTrackingEvents, STATGROUP_PhysicalAudio, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Play Sound From Bone"), STAT_PhysicalAudio_PlaySoundFromBone, STATGROUP_PhysicalAudio, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("On Impact Handle"), STAT_PhysicalAudio_OnImpactHandle, STATGROUP_PhysicalAudio, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Play Impact Sound"), STAT_PhysicalAudio_PlayImpactSound, STATGROUP_PhysicalAudio, );
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Active Components"), STAT_PhysicalAudio_ActiveComponents, STATGROUP_PhysicalAudio, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Evaluated Bones"), STAT_PhysicalAudio_EvaluatedBones, STATGROUP_PhysicalAudio, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Events Loop Start"), STAT_PhysicalAudio_EventsLoopStart, STATGROUP_PhysicalAudio, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Events Loop Stop"), STAT_PhysicalAudio_EventsLoopStop, STATGROUP_PhysicalAudio, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Events Medium"), STAT_PhysicalAudio_EventsMedium, STATGROUP_PhysicalAudio, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Events Fast"), STAT_PhysicalAudio_EventsFast, STATGROUP_PhysicalAudio, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Events Loop Modulated"), STAT_PhysicalAudio_EventsLoopModulated, STATGROUP_PhysicalAudio, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Loop Volume Pushes"), STAT_PhysicalAudio_LoopVolumePushes, STATGROUP_PhysicalAudio, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Rejected Hits Impulse"), STAT_PhysicalAudio_RejectedHitsImpulse, STATGROUP_PhysicalAudio, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Rejected Hits Cooldown"), STAT_PhysicalAudio_RejectedHitsCooldown, STATGROUP_PhysicalAudio, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Rejected Hits Delta Threshold"), STAT_PhysicalAudio_RejectedHitsDeltaThreshold, STATGROUP_PhysicalAudio, );
+
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Live Loop Instances"), STAT_PhysicalAudio_LiveLoops, STATGROUP_PhysicalAudio, );
+
+DECLARE_MEMORY_STAT_EXTERN(TEXT("Tracked State"), STAT_PhysicalAudio_TrackedStateMemory, STATGROUP_PhysicalAudio, );
@@ -0,0 +1,711 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicalAudio.h"
+#include "PhysicalAudioSubsystem.h"
+#include "PhysicalAudioStats.h"
+#include "PhysicalAudioTrace.h"
+#include "PhysicalAudioCapture.h"
+#include "PhysicalAudioComponent.h"
+#include "CollisionAudioComponent.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+#include "Engine/Level.h"
+#include "Components/AudioComponent.h"
+#include "Components/PrimitiveComponent.h"
+#include "AudioDevice.h"
+#include "AudioThread.h"
+#include "ActiveSound.h"
+#include "GameFramework/PlayerController.h"
+#include "Kismet/GameplayStatics.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
+
+static const FName PhysicalAudioSubsystemName(TEXT("PhysicalAudioSubsystem"));
+
+static TAutoConsoleVariable<int32> CVarPhysicalAudioParallelEvaluation(
+	TEXT("pa.Tracking.ParallelEvaluation"),
+	1,
+	TEXT("1: evaluate tracked bones of all components in parallel (default).\n")
+	TEXT("0: evaluate on the game thread."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarPhysicalAudioParallelMinComponents(
+	TEXT("pa.Tracking.ParallelMinComponents"),
+	16,
+	TEXT("Minimum number of registered components before evaluation goes parallel."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarPhysicalAudioPoolCapacity(
+	TEXT("pa.AudioPool.Capacity"),
+	64,
+	TEXT("Maximum number of idle audio components kept per world for loop layers and attached one-shots."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarPhysicalAudioSignificanceEnable(
+	TEXT("pa.Significance.Enable"),
+	1,
+	TEXT("1: reduce tracking of components far from the listener (default).\n")
+	TEXT("0: every component is fully tracked."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarPhysicalAudioSignificanceImportantOnly(
+	TEXT("pa.Significance.ImportantOnlyRatio"),
+	0.4f,
+	TEXT("Listener distance, as a fraction of the audible distance, past which only important bones are tracked."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarPhysicalAudioSignificanceThrottled(
+	TEXT("pa.Significance.ThrottledRatio"),
+	0.7f,
+	TEXT("Listener distance, as a fraction of the audible distance, past which important bones are updated every pa.Significance.ThrottledInterval frames."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarPhysicalAudioSignificanceDormant(
+	TEXT("pa.Significance.DormantRatio"),
+	1.0f,
+	TEXT("Listener distance, as a fraction of the audible distance, past which tracking stops."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarPhysicalAudioSignificanceHysteresis(
+	TEXT("pa.Significance.Hysteresis"),
+	0.05f,
+	TEXT("Ratio band around each significance threshold a component must cross before changing level."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<int32> CVarPhysicalAudioSignificanceThrottledInterval(
+	TEXT("pa.Significance.ThrottledInterval"),
+	4,
+	TEXT("Frames between two updates of a throttled component."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<int32> CVarPhysicalAudioSignificanceMaxFull(
+	TEXT("pa.Significance.MaxFullComponents"),
+	0,
+	TEXT("Maximum number of fully tracked components, the closest ones win. 0 for no limit."),
+	ECVF_Scalability);
+
+/* Level for a distance ratio, thresholds move away from the current level by the hysteresis so levels don't flap. */
+static EPhysicalAudioSignificance ComputeSignificance(EPhysicalAudioSignificance Current, float Ratio)
+{
+	const float Thresholds[] =
+	{
+		CVarPhysicalAudioSignificanceImportantOnly.GetValueOnGameThread(),
+		CVarPhysicalAudioSignificanceThrottled.GetValueOnGameThread(),
+		CVarPhysicalAudioSignificanceDormant.GetValueOnGameThread()
+	};
+	const float Hysteresis = CVarPhysicalAudioSignificanceHysteresis.GetValueOnGameThread();
+
+	int32 Level = 0;
+	for (int32 Index = 0; Index < ARRAY_COUNT(Thresholds); ++Index)
+	{
+		// Below or at the boundary's upper level: must go past it, above: must come back under it
+		const float Threshold = Index < static_cast<int32>(Current) ? Thresholds[Index] - Hysteresis : Thresholds[Index] + Hysteresis;
+		if (Ratio > Threshold)
+		{
+			Level = Index + 1;
+		}
+	}
+
+	return static_cast<EPhysicalAudioSignificance>(Level);
+}
+
+void FPhysicalAudioTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (Target && !Target->IsPendingKill())
+	{
+		switch (Stage)
+		{
+		case EPhysicalAudioTickStage::Tracking:
+			Target->Tick(DeltaTime);
+			break;
+		case EPhysicalAudioTickStage::Flush:
+			Target->Flush(DeltaTime);
+			break;
+		}
+	}
+}
+
+FString FPhysicalAudioTickFunction::DiagnosticMessage()
+{
+	return Stage == EPhysicalAudioTickStage::Flush ? TEXT("FPhysicalAudioTickFunction[Flush]") : TEXT("FPhysicalAudioTickFunction[Tracking]");
+}
+
+UPhysicalAudioSubsystem::UPhysicalAudioSubsystem()
+	: bIsTicking(false)
+{
+	TickFunction.bCanEverTick = true;
+	TickFunction.bStartWithTickEnabled = false;
+	TickFunction.TickGroup = TG_DuringPhysics;
+	TickFunction.Stage = EPhysicalAudioTickStage::Tracking;
+
+	// Always on, collision components submit without registering
+	FlushTickFunction.bCanEverTick = true;
+	FlushTickFunction.bStartWithTickEnabled = true;
+	FlushTickFunction.TickGroup = TG_PostPhysics;
+	FlushTickFunction.Stage = EPhysicalAudioTickStage::Flush;
+}
+
+UPhysicalAudioSubsystem* UPhysicalAudioSubsystem::Get(UWorld* World)
+{
+	if (World == nullptr || !World->IsGameWorld())
+	{
+		return nullptr;
+	}
+
+	UPhysicalAudioSubsystem* Subsystem = FindObjectFast<UPhysicalAudioSubsystem>(World, PhysicalAudioSubsystemName);
+	if (Subsystem == nullptr)
+	{
+		Subsystem = NewObject<UPhysicalAudioSubsystem>(World, PhysicalAudioSubsystemName, RF_Transient);
+		Subsystem->Initialize(World);
+
+		// Keep alive for as long as the world is
+		World->PerModuleDataObjects.Add(Subsystem);
+	}
+
+	return Subsystem;
+}
+
+UPhysicalAudioSubsystem* UPhysicalAudioSubsystem::GetPhysicalAudioSubsystem(UObject* WorldContextObject)
+{
+	return Get(GEngine->GetWorldFromContextObject(WorldContextObject));
+}
+
+void UPhysicalAudioSubsystem::Initialize(UWorld* InWorld)
+{
+	TickFunction.Target = this;
+	TickFunction.RegisterTickFunction(InWorld->PersistentLevel);
+
+	FlushTickFunction.Target = this;
+	FlushTickFunction.RegisterTickFunction(InWorld->PersistentLevel);
+
+	WorldCleanupHandle = FWorldDelegates::OnWorldCleanup.AddUObject(this, &UPhysicalAudioSubsystem::OnWorldCleanup);
+}
+
+void UPhysicalAudioSubsystem::OnWorldCleanup(UWorld* InWorld, bool bSessionEnded, bool bCleanupResources)
+{
+	if (InWorld != GetWorld())
+		return;
+
+	// Pooled components are registered with the world but not owned by any actor
+	for (UAudioComponent* AudioComponent : FreeAudioComponents)
+	{
+		if (AudioComponent && !AudioComponent->IsPendingKill())
+		{
+			AudioComponent->DestroyComponent();
+		}
+	}
+	for (UAudioComponent* AudioComponent : ActiveAudioComponents)
+	{
+		if (AudioComponent && !AudioComponent->IsPendingKill())
+		{
+			AudioComponent->DestroyComponent();
+		}
+	}
+
+	FreeAudioComponents.Empty();
+	ActiveAudioComponents.Empty();
+	ReleasedAudioComponents.Empty();
+
+	PendingImpacts.Empty();
+	ImpactRoutes.Empty();
+	RoutedContacts.Empty();
+	PendingLoopVolumes.Empty();
+	FrameEvents.Empty();
+	VoiceBudget.Reset();
+}
+
+void UPhysicalAudioSubsystem::BeginDestroy()
+{
+	FWorldDelegates::OnWorldCleanup.Remove(WorldCleanupHandle);
+
+	if (TickFunction.IsTickFunctionRegistered())
+	{
+		TickFunction.UnRegisterTickFunction();
+	}
+	TickFunction.Target = nullptr;
+
+	if (FlushTickFunction.IsTickFunctionRegistered())
+	{
+		FlushTickFunction.UnRegisterTickFunction();
+	}
+	FlushTickFunction.Target = nullptr;
+
+	Super::BeginDestroy();
+}
+
+UWorld* UPhysicalAudioSubsystem::GetWorld() const
+{
+	return Cast<UWorld>(GetOuter());
+}
+
+void UPhysicalAudioSubsystem::AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector)
+{
+	UPhysicalAudioSubsystem* This = CastChecked<UPhysicalAudioSubsystem>(InThis);
+	This->VoiceBudget.AddReferencedObjects(Collector);
+
+	Super::AddReferencedObjects(InThis, Collector);
+}
+
+void UPhysicalAudioSubsystem::RegisterComponent(UPhysicalAudioComponent* Component)
+{
+	if (Component)
+	{
+		Components.AddUnique(Component);
+
+		if (!TickFunction.IsTickFunctionEnabled())
+		{
+			TickFunction.SetTickFunctionEnable(true);
+		}
+	}
+}
+
+void UPhysicalAudioSubsystem::UnregisterComponent(UPhysicalAudioComponent* Component)
+{
+	int32 Index = Components.Find(Component);
+	if (Index == INDEX_NONE)
+		return;
+
+	if (bIsTicking)
+	{
+		// Compacted once the current pass is finished
+		Components[Index] = nullptr;
+	}
+	else
+	{
+		Components.RemoveAtSwap(Index);
+	}
+}
+
+void UPhysicalAudioSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_PhysicalAudio_Tick);
+
+	FPhysicalAudioFrameContext Context;
+	Context.DeltaTime = DeltaTime;
+	Context.TimeDilation = UGameplayStatics::GetGlobalTimeDilation(GetWorld());
+	Context.ThrottledInterval = FMath::Max(1, CVarPhysicalAudioSignificanceThrottledInterval.GetValueOnGameThread());
+
+	// Recorded frames replace the real time step while replaying
+	FPhysicalAudioCapture& Capture = FPhysicalAudioCapture::Get();
+	Capture.BeginFrame(Context);
+
+	bIsTicking = true;
+
+	const uint32 StartCycles = FPlatformTime::Cycles();
+
+	// Components registered during this pass start ticking next frame
+	const int32 NumComponents = Components.Num();
+
+	UpdateSignificance();
+
+	// Game thread: sleep/wake, BP custom transforms and bone index resolves
+	for (int32 Index = 0; Index < NumComponents; ++Index)
+	{
+		UPhysicalAudioComponent* Component = Components[Index];
+		if (Component && Component->IsTrackingActive())
+		{
+			if (Component->IsAsleep())
+			{
+				Component->ProbeWake(DeltaTime);
+			}
+
+			if (!Component->IsDormant())
+			{
+				INC_DWORD_STAT(STAT_PhysicalAudio_ActiveComponents);
+				Component->PrepareTracking(Context);
+			}
+		}
+	}
+
+	if (Capture.IsReplaying())
+	{
+		for (int32 Index = 0; Index < NumComponents; ++Index)
+		{
+			UPhysicalAudioComponent* Component = Components[Index];
+			if (Component && Component->IsTrackingActive() && !Component->IsDormant())
+			{
+				Capture.ReplayTrackedBones(Component);
+			}
+		}
+	}
+
+	// Any thread: pure tracking math, events go to the component's own buffer
+	if (EventBuffers.Num() < NumComponents)
+	{
+		EventBuffers.SetNum(NumComponents);
+	}
+
+	const bool bSingleThread = CVarPhysicalAudioParallelEvaluation.GetValueOnGameThread() == 0 || NumComponents < CVarPhysicalAudioParallelMinComponents.GetValueOnGameThread();
+	ParallelFor(NumComponents, [this, &Context](int32 Index)
+	{
+		EventBuffers[Index].Reset();
+
+		UPhysicalAudioComponent* Component = Components[Index];
+		if (Component && Component->IsTrackingActive() && !Component->IsDormant())
+		{
+			Component->EvaluateTracking(Context, EventBuffers[Index]);
+		}
+	}, bSingleThread);
+
+	const uint32 EvaluatedCycles = FPlatformTime::Cycles();
+	Counters.TrackingCycles += EvaluatedCycles - StartCycles;
+
+#if PHYSICALAUDIO_TRACE
+	const bool bTraceBones = FPhysicalAudioTrace::Get().ShouldSampleBones();
+#endif
+
+	// Game thread: sounds and delegates, in registration order then slot order
+	for (int32 Index = 0; Index < NumComponents; ++Index)
+	{
+		UPhysicalAudioComponent* Component = Components[Index];
+		const bool bIsTracked = Component && Component->IsTrackingActive() && !Component->IsDormant();
+
+#if PHYSICALAUDIO_TRACE
+		if (bTraceBones && bIsTracked)
+		{
+			Component->TraceTrackingState();
+		}
+#endif
+
+#if WITH_EDITORONLY_DATA
+		// Every tracked component, not only the ones that raised events this frame
+		if (bIsTracked)
+		{
+			Component->DrawTrackingDebug();
+		}
+#endif
+
+		if (Capture.IsRecording() && bIsTracked)
+		{
+			Capture.RecordTrackedBones(Component);
+		}
+
+		if (Component && EventBuffers[Index].Num() > 0)
+		{
+			Counters.NumEventsApplied += EventBuffers[Index].Num();
+			Component->ApplyTrackingEvents(EventBuffers[Index]);
+		}
+	}
+
+	Counters.ApplyCycles += FPlatformTime::Cycles() - EvaluatedCycles;
+
+	bIsTicking = false;
+
+	Components.RemoveAllSwap([](UPhysicalAudioComponent* Component) { return Component == nullptr; });
+
+	if (Components.Num() == 0)
+	{
+		TickFunction.SetTickFunctionEnable(false);
+	}
+}
+
+void UPhysicalAudioSubsystem::UpdateSignificance()
+{
+	UWorld* World = GetWorld();
+	APlayerController* PlayerController = World ? World->GetFirstPlayerController() : nullptr;
+
+	// Without a listener there is nothing to rank against, captures don't depend on where it is
+	if (CVarPhysicalAudioSignificanceEnable.GetValueOnGameThread() == 0 || PlayerController == nullptr || FPhysicalAudioCapture::Get().IsActive())
+	{
+		for (UPhysicalAudioComponent* Component : Components)
+		{
+			if (Component)
+			{
+				Component->SetSignificance(EPhysicalAudioSignificance::Full);
+			}
+		}
+		return;
+	}
+
+	FVector ListenerLocation, FrontDir, RightDir;
+	PlayerController->GetAudioListenerPosition(ListenerLocation, FrontDir, RightDir);
+
+	SignificanceRanking.Reset();
+	for (UPhysicalAudioComponent* Component : Components)
+	{
+		if (Component && Component->IsTrackingActive())
+		{
+			const float AudibleDistance = FMath::Max(Component->GetMaxAudibleDistance(), 1.f);
+			const float Ratio = FVector::Dist(ListenerLocation, Component->GetTrackedLocation()) / AudibleDistance;
+			SignificanceRanking.Emplace(Ratio, Component);
+		}
+	}
+
+	SignificanceRanking.Sort([](const TPair<float, UPhysicalAudioComponent*>& A, const TPair<float, UPhysicalAudioComponent*>& B) { return A.Key < B.Key; });
+
+	const int32 MaxFullComponents = CVarPhysicalAudioSignificanceMaxFull.GetValueOnGameThread();
+
+	for (int32 Rank = 0; Rank < SignificanceRanking.Num(); ++Rank)
+	{
+		UPhysicalAudioComponent* Component = SignificanceRanking[Rank].Value;
+		EPhysicalAudioSignificance Significance = ComputeSignificance(Component->GetSignificance(), SignificanceRanking[Rank].Key);
+
+		// Past the full budget the closest components keep their bones, the rest fall back to important ones
+		if (Significance == EPhysicalAudioSignificance::Full && MaxFullComponents > 0 && Rank >= MaxFullComponents)
+		{
+			Significance = EPhysicalAudioSignificance::ImportantOnly;
+		}
+
+		Component->SetSignificance(Significance);
+	}
+}
+
+void UPhysicalAudioSubsystem::Flush(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_PhysicalAudio_Flush);
+
+	const uint32 StartCycles = FPlatformTime::Cycles();
+
+	// Routed hits first, coalescing components queue them for the resolve below
+	DispatchRoutedContacts();
+
+	// One validation and at most one voice request per collision component
+	Swap(PendingImpacts, ResolvingImpacts);
+	for (UCollisionAudioComponent* Component : ResolvingImpacts)
+	{
+		if (Component && !Component->IsPendingKill())
+		{
+			Component->ResolvePendingImpact();
+		}
+	}
+	ResolvingImpacts.Reset();
+
+	VoiceBudget.Flush(GetWorld());
+
+	FlushLoopVolumes();
+
+	// One call per listener for the whole frame, events raised by the listeners go to the next one
+	if (FrameEvents.Num() > 0)
+	{
+		Swap(FrameEvents, BroadcastEvents);
+		NativeEvents.Broadcast(TArrayView<const FPhysicalAudioEventRecord>(BroadcastEvents));
+		OnEvents.Broadcast(BroadcastEvents);
+		BroadcastEvents.Reset();
+	}
+
+	Counters.FlushCycles += FPlatformTime::Cycles() - StartCycles;
+}
+
+void UPhysicalAudioSubsystem::QueueImpact(UCollisionAudioComponent* Component)
+{
+	PendingImpacts.Add(Component);
+}
+
+void UPhysicalAudioSubsystem::RegisterImpactRoutes(UCollisionAudioComponent* Component)
+{
+	PurgeStaleImpactRoutes();
+
+	for (TWeakObjectPtr<UPrimitiveComponent> const& NotifyComponent : Component->GetNotifyComponents())
+	{
+		UPrimitiveComponent* Primitive = NotifyComponent.Get();
+		if (Primitive == nullptr)
+			continue;
+
+		if (ImpactRoutes.Find(NotifyComponent) == nullptr)
+		{
+			Primitive->OnComponentHit.AddUniqueDynamic(this, &UPhysicalAudioSubsystem::OnRoutedHit);
+		}
+		ImpactRoutes.AddUnique(NotifyComponent, Component);
+	}
+}
+
+void UPhysicalAudioSubsystem::UnregisterImpactRoutes(UCollisionAudioComponent* Component)
+{
+	for (TWeakObjectPtr<UPrimitiveComponent> const& NotifyComponent : Component->GetNotifyComponents())
+	{
+		// Removed by key even if the primitive is already gone
+		ImpactRoutes.RemoveSingle(NotifyComponent, Component);
+
+		UPrimitiveComponent* Primitive = NotifyComponent.Get();
+		if (Primitive && ImpactRoutes.Find(NotifyComponent) == nullptr)
+		{
+			Primitive->OnComponentHit.RemoveDynamic(this, &UPhysicalAudioSubsystem::OnRoutedHit);
+		}
+	}
+}
+
+void UPhysicalAudioSubsystem::PurgeStaleImpactRoutes()
+{
+	TArray<TWeakObjectPtr<UPrimitiveComponent>, TInlineAllocator<4>> OrphanedPrimitives;
+
+	for (auto It = ImpactRoutes.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid())
+		{
+			It.RemoveCurrent();
+		}
+		else if (!It.Value().IsValid())
+		{
+			OrphanedPrimitives.AddUnique(It.Key());
+			It.RemoveCurrent();
+		}
+	}
+
+	for (TWeakObjectPtr<UPrimitiveComponent> const& Primitive : OrphanedPrimitives)
+	{
+		if (ImpactRoutes.Find(Primitive) == nullptr)
+		{
+			Primitive->OnComponentHit.RemoveDynamic(this, &UPhysicalAudioSubsystem::OnRoutedHit);
+		}
+	}
+}
+
+void UPhysicalAudioSubsystem::OnRoutedHit(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
+{
+	FPhysicalAudioRoutedContact Contact;
+	Contact.Primitive = HitComponent;
+	Contact.NormalImpulse = NormalImpulse;
+	Contact.Location = Hit.Location;
+	RoutedContacts.Add(Contact);
+}
+
+void UPhysicalAudioSubsystem::DispatchRoutedContacts()
+{
+	for (FPhysicalAudioRoutedContact const& Contact : RoutedContacts)
+	{
+		for (auto It = ImpactRoutes.CreateConstKeyIterator(Contact.Primitive); It; ++It)
+		{
+			UCollisionAudioComponent* Component = It.Value().Get();
+			if (Component && !Component->IsPendingKill())
+			{
+				Component->HandleImpact(Contact.NormalImpulse, Contact.Location);
+			}
+		}
+	}
+	RoutedContacts.Reset();
+}
+
+void UPhysicalAudioSubsystem::QueueLoopVolume(UAudioComponent* AudioComponent, float Volume)
+{
+	// Game thread copy, picked up if the sound restarts
+	AudioComponent->VolumeMultiplier = Volume;
+
+	PendingLoopVolumes.Emplace(AudioComponent->GetAudioComponentID(), Volume);
+}
+
+void UPhysicalAudioSubsystem::FlushLoopVolumes()
+{
+	if (PendingLoopVolumes.Num() == 0)
+		return;
+
+	UWorld* World = GetWorld();
+	FAudioDevice* AudioDevice = World ? World->GetAudioDevice() : nullptr;
+	if (AudioDevice == nullptr)
+	{
+		PendingLoopVolumes.Reset();
+		return;
+	}
+
+	// Loops that stopped in the meantime are simply not found
+	FAudioThread::RunCommandOnAudioThread([AudioDevice, LoopVolumes = MoveTemp(PendingLoopVolumes)]()
+	{
+		for (TPair<uint64, float> const& LoopVolume : LoopVolumes)
+		{
+			if (FActiveSound* ActiveSound = AudioDevice->FindActiveSound(LoopVolume.Key))
+			{
+				ActiveSound->VolumeMultiplier = LoopVolume.Value;
+			}
+		}
+	});
+
+	PendingLoopVolumes.Reset();
+}
+
+void UPhysicalAudioSubsystem::SubmitVoice(const FPhysicalAudioVoiceRequest& Request)
+{
+	++Counters.NumVoicesSubmitted;
+	VoiceBudget.Submit(Request);
+}
+
+UAudioComponent* UPhysicalAudioSubsystem::AcquireAudioComponent(USoundBase* Sound, USceneComponent* AttachTo, FName AttachName, float VolumeMultiplier)
+{
+	UWorld* World = GetWorld();
+	if (Sound == nullptr || AttachTo == nullptr || World == nullptr || World->bIsTearingDown)
+	{
+		return nullptr;
+	}
+
+	UAudioComponent* AudioComponent = nullptr;
+	while (AudioComponent == nullptr && FreeAudioComponents.Num() > 0)
+	{
+		AudioComponent = FreeAudioComponents.Pop(false);
+		if (AudioComponent && AudioComponent->IsPendingKill())
+		{
+			AudioComponent = nullptr;
+		}
+	}
+
+	if (AudioComponent == nullptr)
+	{
+		AudioComponent = NewObject<UAudioComponent>(this);
+		AudioComponent->bAutoActivate = false;
+		AudioComponent->bAutoDestroy = false;
+		AudioComponent->bStopWhenOwnerDestroyed = false;
+		AudioComponent->RegisterComponentWithWorld(World);
+	}
+
+	// Cleared with every other binding when the component went back to the pool
+	AudioComponent->OnAudioFinishedNative.AddUObject(this, &UPhysicalAudioSubsystem::OnPooledAudioFinished);
+
+	ActiveAudioComponents.Add(AudioComponent);
+
+	AudioComponent->AttachToComponent(AttachTo, FAttachmentTransformRules::SnapToTargetNotIncludingScale, AttachName);
+	AudioComponent->SetSound(Sound);
+	AudioComponent->SetVolumeMultiplier(VolumeMultiplier);
+	AudioComponent->Play();
+
+	return AudioComponent;
+}
+
+void UPhysicalAudioSubsystem::ReleaseAudioComponent(UAudioComponent* AudioComponent)
+{
+	if (!ActiveAudioComponents.Contains(AudioComponent))
+		return;
+
+	if (AudioComponent->IsPlaying())
+	{
+		// Fading or one-shot still playing, back to the pool once finished
+		ReleasedAudioComponents.Add(AudioComponent);
+	}
+	else
+	{
+		ReturnToPool(AudioComponent);
+	}
+}
+
+void UPhysicalAudioSubsystem::OnPooledAudioFinished(UAudioComponent* AudioComponent)
+{
+	if (ReleasedAudioComponents.Contains(AudioComponent))
+	{
+		ReturnToPool(AudioComponent);
+	}
+}
+
+void UPhysicalAudioSubsystem::ReturnToPool(UAudioComponent* AudioComponent)
+{
+	ActiveAudioComponents.Remove(AudioComponent);
+	ReleasedAudioComponents.Remove(AudioComponent);
+
+	if (AudioComponent->IsPendingKill())
+		return;
+
+	AudioComponent->DetachFromComponent(FDetachmentTransformRules::KeepWorldTransform);
+
+	// One-shots are handed to BP, the next user must not inherit its bindings or parameters
+	AudioComponent->OnAudioFinished.Clear();
+	AudioComponent->OnAudioFinishedNative.Clear();
+	AudioComponent->OnAudioPlaybackPercent.Clear();
+	AudioComponent->InstanceParameters.Reset();
+	AudioComponent->SetPitchMultiplier(1.f);
+	AudioComponent->bOverrideAttenuation = false;
+	AudioComponent->SetSound(nullptr);
+
+	if (FreeAudioComponents.Num() < CVarPhysicalAudioPoolCapacity.GetValueOnGameThread())
+	{
+		FreeAudioComponents.Add(AudioComponent);
+	}
+	else
+	{
+		AudioComponent->DestroyComponent();
+	}
+}
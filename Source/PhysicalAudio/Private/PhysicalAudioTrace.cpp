@@ -0,0 +1,209 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicalAudio.h"
+#include "PhysicalAudioTrace.h"
+
+#if PHYSICALAUDIO_TRACE
+
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+static TAutoConsoleVariable<int32> CVarPhysicalAudioTraceEnable(
+	TEXT("pa.Trace.Enable"),
+	0,
+	TEXT("1: record bone samples, tracking events and impact decisions into the trace buffer, see pa.Trace.Export."),
+	ECVF_Cheat);
+
+static TAutoConsoleVariable<FString> CVarPhysicalAudioTraceFilter(
+	TEXT("pa.Trace.Filter"),
+	TEXT(""),
+	TEXT("Only trace components whose owner name contains this string. Empty to trace every component."),
+	ECVF_Cheat);
+
+static TAutoConsoleVariable<int32> CVarPhysicalAudioTraceSampleInterval(
+	TEXT("pa.Trace.SampleInterval"),
+	1,
+	TEXT("Frames between two bone samples, events and impacts are always recorded. 0 to only record events and impacts."),
+	ECVF_Cheat);
+
+static TAutoConsoleVariable<int32> CVarPhysicalAudioTraceCapacity(
+	TEXT("pa.Trace.Capacity"),
+	65536,
+	TEXT("Number of records kept, the oldest ones are overwritten once full."),
+	ECVF_Cheat);
+
+static void ExportPhysicalAudioTrace(const TArray<FString>& Args)
+{
+	const FString FileName = Args.Num() > 0 ? Args[0] : FPaths::ProfilingDir() / TEXT("PhysicalAudio") / FString::Printf(TEXT("Trace-%s.csv"), *FDateTime::Now().ToString());
+
+	if (FPhysicalAudioTrace::Get().ExportCsv(FileName))
+	{
+		UE_LOG(LogPhysicalAudio, Display, TEXT("Physical audio trace exported to %s"), *FileName);
+	}
+	else
+	{
+		UE_LOG(LogPhysicalAudio, Warning, TEXT("Physical audio trace could not be exported to %s"), *FileName);
+	}
+}
+
+static FAutoConsoleCommand CmdPhysicalAudioTraceExport(
+	TEXT("pa.Trace.Export"),
+	TEXT("Write the physical audio trace buffer as CSV. Optional argument: file name, defaults to Saved/Profiling/PhysicalAudio."),
+	FConsoleCommandWithArgsDelegate::CreateStatic(&ExportPhysicalAudioTrace));
+
+// Filter results kept before destroyed components are pruned, doubles when most entries are alive
+static const int32 MinPruneThreshold = 256;
+
+FPhysicalAudioTrace& FPhysicalAudioTrace::Get()
+{
+	static FPhysicalAudioTrace Trace;
+	return Trace;
+}
+
+FPhysicalAudioTrace::FPhysicalAudioTrace()
+	: Head(0)
+	, bWrapped(false)
+	, bEnabled(false)
+	, SampleInterval(1)
+	, StartTime(FPlatformTime::Seconds())
+	, PruneThreshold(MinPruneThreshold)
+{
+	OnSettingsChanged();
+
+	IConsoleManager::Get().RegisterConsoleVariableSink(FConsoleCommandDelegate::CreateStatic(&FPhysicalAudioTrace::OnConsoleVariablesChanged));
+}
+
+void FPhysicalAudioTrace::OnConsoleVariablesChanged()
+{
+	Get().OnSettingsChanged();
+}
+
+void FPhysicalAudioTrace::OnSettingsChanged()
+{
+	bEnabled = CVarPhysicalAudioTraceEnable.GetValueOnGameThread() != 0;
+	SampleInterval = CVarPhysicalAudioTraceSampleInterval.GetValueOnGameThread();
+
+	const FString NewFilter = CVarPhysicalAudioTraceFilter.GetValueOnGameThread();
+	const int32 NewCapacity = FMath::Max(1, CVarPhysicalAudioTraceCapacity.GetValueOnGameThread());
+
+	// Nothing is allocated until the trace is first enabled
+	const bool bResize = bEnabled && NewCapacity != Records.Num();
+	if (NewFilter != Filter || bResize)
+	{
+		Filter = NewFilter;
+		if (bResize)
+		{
+			Records.SetNumUninitialized(NewCapacity);
+		}
+		Reset();
+	}
+}
+
+void FPhysicalAudioTrace::Reset()
+{
+	Head = 0;
+	bWrapped = false;
+	StartTime = FPlatformTime::Seconds();
+	FilterResults.Reset();
+	ComponentNames.Reset();
+	PruneThreshold = MinPruneThreshold;
+}
+
+void FPhysicalAudioTrace::PruneFilterResults()
+{
+	for (auto It = FilterResults.CreateIterator(); It; ++It)
+	{
+		if (It.Key().ResolveObjectPtr() == nullptr)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	PruneThreshold = FMath::Max(MinPruneThreshold, FilterResults.Num() * 2);
+}
+
+bool FPhysicalAudioTrace::ShouldSampleBones() const
+{
+	return bEnabled && SampleInterval > 0 && GFrameCounter % SampleInterval == 0;
+}
+
+int32 FPhysicalAudioTrace::FindTracedComponent(const UObject* Component)
+{
+	if (!bEnabled || Component == nullptr)
+	{
+		return INDEX_NONE;
+	}
+
+	// Names are only compared the first time a component is seen
+	const FObjectKey ComponentKey(Component);
+	if (int32* FilterResult = FilterResults.Find(ComponentKey))
+	{
+		return *FilterResult;
+	}
+
+	if (FilterResults.Num() >= PruneThreshold)
+	{
+		PruneFilterResults();
+	}
+
+	const UObject* Owner = Component->GetOuter();
+	const FString Name = Owner ? FString::Printf(TEXT("%s.%s"), *Owner->GetName(), *Component->GetName()) : Component->GetName();
+	const int32 ComponentIndex = Filter.IsEmpty() || Name.Contains(Filter) ? ComponentNames.Add(Name) : INDEX_NONE;
+
+	FilterResults.Add(ComponentKey, ComponentIndex);
+	return ComponentIndex;
+}
+
+void FPhysicalAudioTrace::Record(int32 ComponentIndex, EPhysicalAudioTraceType Type, int32 Slot, uint8 Code, float Value0, float Value1)
+{
+	FPhysicalAudioTraceRecord& Record = Records[Head];
+	Record.Frame = GFrameCounter;
+	Record.Time = (float)(FPlatformTime::Seconds() - StartTime);
+	Record.ComponentIndex = (uint32)ComponentIndex;
+	Record.Slot = (uint16)Slot;
+	Record.Type = Type;
+	Record.Code = Code;
+	Record.Value0 = Value0;
+	Record.Value1 = Value1;
+
+	if (++Head == Records.Num())
+	{
+		Head = 0;
+		bWrapped = true;
+	}
+}
+
+bool FPhysicalAudioTrace::ExportCsv(const FString& FileName) const
+{
+	static const TCHAR* TypeNames[] = { TEXT("BoneSample"), TEXT("Event"), TEXT("ImpactRejected"), TEXT("ImpactAccepted") };
+	static const TCHAR* EventNames[] = { TEXT("None"), TEXT("SlowThresholdStart"), TEXT("SlowThresholdStop"), TEXT("MediumThreshold"), TEXT("FastThreshold"), TEXT("LoopModulated") };
+	static const TCHAR* RejectionNames[] = { TEXT("Impulse"), TEXT("Cooldown"), TEXT("DeltaThreshold") };
+
+	FString Csv = TEXT("Frame,Time,Component,Slot,Type,Code,Value0,Value1\n");
+
+	const int32 NumRecords = bWrapped ? Records.Num() : Head;
+	const int32 First = bWrapped ? Head : 0;
+	for (int32 Index = 0; Index < NumRecords; ++Index)
+	{
+		FPhysicalAudioTraceRecord const& Record = Records[(First + Index) % Records.Num()];
+
+		const TCHAR* CodeName = TEXT("");
+		if (Record.Type == EPhysicalAudioTraceType::Event && Record.Code < ARRAY_COUNT(EventNames))
+		{
+			CodeName = EventNames[Record.Code];
+		}
+		else if (Record.Type == EPhysicalAudioTraceType::ImpactRejected && Record.Code < ARRAY_COUNT(RejectionNames))
+		{
+			CodeName = RejectionNames[Record.Code];
+		}
+
+		const TCHAR* Name = ComponentNames.IsValidIndex(Record.ComponentIndex) ? *ComponentNames[Record.ComponentIndex] : TEXT("");
+		Csv += FString::Printf(TEXT("%llu,%.4f,%s,%d,%s,%s,%f,%f\n"),
+			Record.Frame, Record.Time, Name, Record.Slot, TypeNames[(uint8)Record.Type], CodeName, Record.Value0, Record.Value1);
+	}
+
+	return FFileHelper::SaveStringToFile(Csv, *FileName);
+}
+
+#endif
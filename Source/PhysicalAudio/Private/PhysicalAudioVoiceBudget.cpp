@@ -0,0 +1,317 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicalAudio.h"
+#include "PhysicalAudioVoiceBudget.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "Sound/SoundBase.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<int32> CVarPhysicalAudioVoiceBudgetEnable(
+	TEXT("pa.VoiceBudget.Enable"),
+	1,
+	TEXT("1: physical audio one-shots go through the voice budget (default).\n")
+	TEXT("0: one-shots start as soon as they are requested."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarPhysicalAudioVoiceBudgetMaxPerFrame(
+	TEXT("pa.VoiceBudget.MaxPerFrame"),
+	16,
+	TEXT("Maximum number of physical audio one-shots started per frame."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<int32> CVarPhysicalAudioVoiceBudgetMaxConcurrent(
+	TEXT("pa.VoiceBudget.MaxConcurrent"),
+	48,
+	TEXT("Maximum number of physical audio one-shots playing at once."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarPhysicalAudioVoiceBudgetMaxDistance(
+	TEXT("pa.VoiceBudget.MaxDistance"),
+	5000.f,
+	TEXT("Listener distance at which the distance term of a voice score reaches zero."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<int32> CVarPhysicalAudioVoiceBudgetCluster(
+	TEXT("pa.VoiceBudget.Cluster"),
+	1,
+	TEXT("1: merge clustered requests of the same sound landing close together (default).\n")
+	TEXT("0: every request is scored on its own."),
+	ECVF_Default);
+
+static TAutoConsoleVariable<float> CVarPhysicalAudioVoiceBudgetClusterCellSize(
+	TEXT("pa.VoiceBudget.ClusterCellSize"),
+	200.f,
+	TEXT("Size of the spatial hash cells requests are merged in."),
+	ECVF_Scalability);
+
+static TAutoConsoleVariable<float> CVarPhysicalAudioVoiceBudgetClusterWindow(
+	TEXT("pa.VoiceBudget.ClusterWindow"),
+	0.05f,
+	TEXT("Seconds during which a cell's voice absorbs later requests of the same cluster."),
+	ECVF_Scalability);
+
+// Power of two, the table never grows so clustering never allocates once warm
+static const int32 NumClusterCells = 1024;
+
+// Past this many probes the request is left alone rather than clustered
+static const int32 MaxClusterProbes = 8;
+
+// Score weights, intensity dominates so a loud hit far away still beats a scrape next to the listener
+static const float IntensityWeight = 0.5f;
+static const float DistanceWeight = 0.3f;
+static const float RecencyWeight = 0.2f;
+
+// Owners that played within this time get a lower recency score
+static const float RecencyWindow = 0.5f;
+
+// Upper bound of a voice's expected duration, for looping or unknown durations
+static const float MaxVoiceDuration = 10.f;
+
+FPhysicalAudioVoiceBudget::FPhysicalAudioVoiceBudget()
+	: FlushIndex(0)
+	, NumMergedLastFlush(0)
+	, NumAdmittedLastFlush(0)
+	, NumRejectedLastFlush(0)
+	, NumRejectedTotal(0)
+{
+}
+
+void FPhysicalAudioVoiceBudget::Submit(const FPhysicalAudioVoiceRequest& Request)
+{
+	if (Request.Sound == nullptr || Request.Requester == nullptr || !Request.Owner.IsValid())
+		return;
+
+	if (CVarPhysicalAudioVoiceBudgetEnable.GetValueOnGameThread() == 0)
+	{
+		Request.Requester->StartBudgetedVoice(Request);
+		return;
+	}
+
+	PendingRequests.Add(Request);
+}
+
+void FPhysicalAudioVoiceBudget::Flush(UWorld* World)
+{
+	NumAdmittedLastFlush = 0;
+	NumRejectedLastFlush = 0;
+	NumMergedLastFlush = 0;
+
+	if (PendingRequests.Num() == 0 || World == nullptr)
+		return;
+
+	const float CurrentTime = World->GetAudioTimeSeconds();
+
+	// Voices expected to have finished
+	ActiveVoiceEndTimes.RemoveAllSwap([CurrentTime](float EndTime) { return EndTime <= CurrentTime; });
+
+	Swap(PendingRequests, FlushingRequests);
+	PendingRequests.Reset();
+
+	// Owners destroyed while queued neither lead a cluster nor take a slot
+	FlushingRequests.RemoveAll([](const FPhysicalAudioVoiceRequest& Request) { return !Request.Owner.IsValid(); });
+
+	if (CVarPhysicalAudioVoiceBudgetCluster.GetValueOnGameThread() != 0)
+	{
+		ClusterRequests(CurrentTime);
+	}
+
+	ScoreRequests(World, CurrentTime);
+
+	// Best first, submission order breaks ties so results are deterministic
+	FlushingRequests.StableSort([](const FPhysicalAudioVoiceRequest& A, const FPhysicalAudioVoiceRequest& B) { return A.Score > B.Score; });
+
+	const int32 FreeVoices = FMath::Max(0, CVarPhysicalAudioVoiceBudgetMaxConcurrent.GetValueOnGameThread() - ActiveVoiceEndTimes.Num());
+	const int32 MaxToAdmit = FMath::Min(CVarPhysicalAudioVoiceBudgetMaxPerFrame.GetValueOnGameThread(), FreeVoices);
+
+	int32 Index = 0;
+	for (; Index < FlushingRequests.Num() && NumAdmittedLastFlush < MaxToAdmit; ++Index)
+	{
+		// A voice started before may have destroyed this owner
+		const FPhysicalAudioVoiceRequest& Request = FlushingRequests[Index];
+		if (!Request.Owner.IsValid())
+			continue;
+
+		float Duration = Request.Sound->GetDuration();
+		if (Request.PitchMultiplier > KINDA_SMALL_NUMBER)
+		{
+			Duration /= Request.PitchMultiplier;
+		}
+		ActiveVoiceEndTimes.Add(CurrentTime + FMath::Min(Duration, MaxVoiceDuration));
+		LastVoiceTimes.Add(Request.Owner, CurrentTime);
+
+		// The cluster now has a voice to absorb later requests into
+		if (Request.ClusterCellIndex != INDEX_NONE)
+		{
+			ClusterCells[Request.ClusterCellIndex].EmitTime = CurrentTime;
+		}
+
+		Request.Requester->StartBudgetedVoice(Request);
+		++NumAdmittedLastFlush;
+	}
+
+	// Left over past the cap, the dead among them don't count as rejected
+	for (; Index < FlushingRequests.Num(); ++Index)
+	{
+		if (FlushingRequests[Index].Owner.IsValid())
+		{
+			++NumRejectedLastFlush;
+		}
+	}
+	NumRejectedTotal += NumRejectedLastFlush;
+
+	UE_CLOG(NumRejectedLastFlush > 0 || NumMergedLastFlush > 0, LogPhysicalAudio, Verbose, TEXT("Voice budget: %d admitted, %d rejected, %d merged, %d playing."), NumAdmittedLastFlush, NumRejectedLastFlush, NumMergedLastFlush, ActiveVoiceEndTimes.Num());
+
+	FlushingRequests.Reset();
+
+	// Drop owners that are gone or out of the recency window
+	for (auto It = LastVoiceTimes.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid() || CurrentTime - It.Value() > RecencyWindow)
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void FPhysicalAudioVoiceBudget::Reset()
+{
+	PendingRequests.Reset();
+	FlushingRequests.Reset();
+	ActiveVoiceEndTimes.Reset();
+	LastVoiceTimes.Reset();
+	ClusterCells.Reset();
+}
+
+void FPhysicalAudioVoiceBudget::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	for (FPhysicalAudioVoiceRequest& Request : PendingRequests)
+	{
+		Collector.AddReferencedObject(Request.Sound);
+	}
+}
+
+void FPhysicalAudioVoiceBudget::ClusterRequests(float CurrentTime)
+{
+	if (ClusterCells.Num() == 0)
+	{
+		FClusterCell EmptyCell;
+		FMemory::Memzero(EmptyCell);
+		EmptyCell.FlushIndex = INDEX_NONE;
+		EmptyCell.EmitTime = -BIG_NUMBER;
+		ClusterCells.Init(EmptyCell, NumClusterCells);
+	}
+
+	++FlushIndex;
+
+	const float InvCellSize = 1.f / FMath::Max(1.f, CVarPhysicalAudioVoiceBudgetClusterCellSize.GetValueOnGameThread());
+	const float Window = CVarPhysicalAudioVoiceBudgetClusterWindow.GetValueOnGameThread();
+
+	for (int32 Index = 0; Index < FlushingRequests.Num(); ++Index)
+	{
+		FPhysicalAudioVoiceRequest& Request = FlushingRequests[Index];
+		if (Request.ClusterId == 0)
+			continue;
+
+		const FIntVector Cell(FMath::FloorToInt(Request.Location.X * InvCellSize), FMath::FloorToInt(Request.Location.Y * InvCellSize), FMath::FloorToInt(Request.Location.Z * InvCellSize));
+		const uint32 Hash = HashCombine(HashCombine(GetTypeHash(Cell), Request.ClusterId), PointerHash(Request.Sound));
+
+		int32 FreeCellIndex = INDEX_NONE;
+		FClusterCell* MatchCell = nullptr;
+
+		for (int32 Probe = 0; Probe < MaxClusterProbes; ++Probe)
+		{
+			const int32 CellIndex = (Hash + Probe) & (NumClusterCells - 1);
+			FClusterCell& ClusterCell = ClusterCells[CellIndex];
+
+			// Leading a request of this flush, or a started voice still within the window
+			const bool bIsLive = ClusterCell.FlushIndex == FlushIndex || CurrentTime - ClusterCell.EmitTime <= Window;
+			if (!bIsLive)
+			{
+				FreeCellIndex = FreeCellIndex == INDEX_NONE ? CellIndex : FreeCellIndex;
+			}
+			else if (ClusterCell.Cell == Cell && ClusterCell.ClusterId == Request.ClusterId && ClusterCell.Sound == Request.Sound)
+			{
+				MatchCell = &ClusterCell;
+				break;
+			}
+		}
+
+		if (MatchCell == nullptr)
+		{
+			// New cluster led by this request, or no room left and it plays on its own.
+			// Nothing is absorbed past this flush unless the leader is admitted, see Flush
+			if (FreeCellIndex != INDEX_NONE)
+			{
+				FClusterCell& FreeCell = ClusterCells[FreeCellIndex];
+				FreeCell.Cell = Cell;
+				FreeCell.ClusterId = Request.ClusterId;
+				FreeCell.Sound = Request.Sound;
+				FreeCell.LeaderIndex = Index;
+				FreeCell.FlushIndex = FlushIndex;
+				FreeCell.IntensitySquared = FMath::Square(Request.Intensity);
+				FreeCell.EmitTime = -BIG_NUMBER;
+
+				Request.ClusterCellIndex = FreeCellIndex;
+			}
+			continue;
+		}
+
+		if (MatchCell->FlushIndex == FlushIndex)
+		{
+			// Combined energy of the merged impacts, the strongest one decides where it plays
+			FPhysicalAudioVoiceRequest& Leader = FlushingRequests[MatchCell->LeaderIndex];
+			if (Request.Intensity > Leader.Intensity)
+			{
+				Leader.Location = Request.Location;
+			}
+
+			MatchCell->IntensitySquared += FMath::Square(Request.Intensity);
+			Leader.Intensity = FMath::Min(1.f, FMath::Sqrt(MatchCell->IntensitySquared));
+			++Leader.NumMerged;
+		}
+
+		// Merged into this flush's leader, or into a voice started within the window
+		Request.Requester = nullptr;
+		++NumMergedLastFlush;
+	}
+
+	if (NumMergedLastFlush > 0)
+	{
+		FlushingRequests.RemoveAll([](const FPhysicalAudioVoiceRequest& Request) { return Request.Requester == nullptr; });
+	}
+}
+
+void FPhysicalAudioVoiceBudget::ScoreRequests(UWorld* World, float CurrentTime)
+{
+	FVector ListenerLocation(FVector::ZeroVector);
+	bool bHasListener = false;
+
+	if (APlayerController* PlayerController = World->GetFirstPlayerController())
+	{
+		FVector FrontDir, RightDir;
+		PlayerController->GetAudioListenerPosition(ListenerLocation, FrontDir, RightDir);
+		bHasListener = true;
+	}
+
+	const float MaxDistance = FMath::Max(1.f, CVarPhysicalAudioVoiceBudgetMaxDistance.GetValueOnGameThread());
+
+	for (FPhysicalAudioVoiceRequest& Request : FlushingRequests)
+	{
+		const float IntensityTerm = FMath::Clamp(Request.Intensity, 0.f, 1.f);
+
+		float DistanceTerm = 1.f;
+		if (bHasListener)
+		{
+			DistanceTerm = 1.f - FMath::Clamp(FVector::Dist(ListenerLocation, Request.Location) / MaxDistance, 0.f, 1.f);
+		}
+
+		float RecencyTerm = 1.f;
+		if (const float* LastVoiceTime = LastVoiceTimes.Find(Request.Owner))
+		{
+			RecencyTerm = FMath::Clamp((CurrentTime - *LastVoiceTime) / RecencyWindow, 0.f, 1.f);
+		}
+
+		Request.Score = IntensityTerm * IntensityWeight + DistanceTerm * DistanceWeight + RecencyTerm * RecencyWeight;
+	}
+}
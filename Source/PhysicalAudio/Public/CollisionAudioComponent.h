@@ -5,9 +5,12 @@
 #include "Components/ActorComponent.h"
 #include "Engine/DataTable.h"
 #include "Kismet/KismetSystemLibrary.h"
+#include "PhysicalAudioVoiceBudget.h"
 #include "CollisionAudioComponent.generated.h"
 
 class UAudioComponent;
+class UPhysicalAudioSubsystem;
+struct FCollisionAudioPreset;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnPlayCollisionSound, UCollisionAudioComponent*, CollisionAudioComponent, USoundBase*, Sound);
 
@@ -27,11 +30,12 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "AudioImpactData")
 	float ImpactMagnitudeThresholdMax;
 
+	// Streamed in while a component uses the row
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "AudioImpactData")
-	USoundBase* SoundDefault;
+	TAssetPtr<USoundBase> SoundDefault;
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "AudioImpactData")
-	USoundBase* SoundHeavy;
+	TAssetPtr<USoundBase> SoundHeavy;
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "AudioImpactData")
 	float PitchModulationMin;
@@ -59,18 +63,48 @@ public:
 	}
 };
 
+/* Contacts of one frame, folded into a single impact. */
+struct FCollisionAudioPendingImpact
+{
+	FCollisionAudioPendingImpact()
+		: Impulse(FVector::ZeroVector)
+		, Location(FVector::ZeroVector)
+		, NumContacts(0)
+	{
+	}
+
+	// Strongest impulse of the frame and where it hit
+	FVector Impulse;
+	FVector Location;
+
+	int32 NumContacts;
+};
+
 /*
 * Audio base on physical collision. 
 */
 UCLASS( ClassGroup=(PhysicalAudio), meta=(BlueprintSpawnableComponent) )
-class PHYSICALAUDIO_API UCollisionAudioComponent : public UActorComponent
+class PHYSICALAUDIO_API UCollisionAudioComponent : public UActorComponent, public FPhysicalAudioVoiceRequester
 {
 	GENERATED_BODY()
 
+	friend class UPhysicalAudioBenchmarkCommandlet;
+
 protected:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, category = "Collision Audio")
 	uint32 bDisableDeltaThreshold : 1;
 
+	/* Fold every contact of a frame into one impact, resolved after physics. Only the strongest contact can play. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, category = "Collision Audio")
+	uint32 bCoalesceImpacts : 1;
+
+	/*
+	* Hand the bound components to the subsystem instead of binding our own hit events.
+	* It listens to them with a single handler and plays their contacts in one pass after physics.
+	*/
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, category = "Collision Audio")
+	uint32 bRouteHitsThroughSubsystem : 1;
+
 	/* Collision impact table. */
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, category = "Collision Audio")
 	UDataTable* DataTableAsset;
@@ -111,8 +145,26 @@ protected:
 	UPROPERTY(Transient)
 	float ImpulseMagnitude;
 
+	/* Shared impact config of @ImpactNameRef, see FPhysicalAudioPresetRegistry. */
+	TSharedPtr<const FCollisionAudioPreset> ImpactPreset;
+
+	/* Preset's impact data, null until a row was found. */
+	FCollisionAudioImpactData const* ImpactAudioData;
+
+	/* Hit events are bound once, changing rows only swaps the preset. */
+	bool bCollisionEventBound;
+
+	/* NotifyComponents are registered with the subsystem, see bRouteHitsThroughSubsystem. */
+	bool bHitsRouted;
+
+	/* Voice budget owner of this world. */
 	UPROPERTY(Transient)
-	FCollisionAudioImpactData ImpactAudioData;
+	UPhysicalAudioSubsystem* Subsystem;
+
+	FCollisionAudioPendingImpact PendingImpact;
+
+	/* Components whose hit notifies we listen to. */
+	TArray<TWeakObjectPtr<UPrimitiveComponent>> NotifyComponents;
 
 #if WITH_EDITORONLY_DATA
 	/* Edit Only: Display collision impact msg. */
@@ -128,6 +180,8 @@ protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	UFUNCTION(BlueprintCallable, category = "Components|CollisionAudio")
 	void Initialize();
 
@@ -143,13 +197,16 @@ protected:
 	UFUNCTION(BlueprintCallable, category = "Components|CollisionAudio")
 	void OnTaggedComponentHit(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit);
 
+	/* Validate a hit and play its sound. */
+	void ProcessImpact(FVector NormalImpulse, FVector Location);
+
 	bool DetectValidHit(FVector Impulse);
 	void PlayImpactSound(FVector Location);
 
-	FORCEINLINE bool IsRetriggerCooldown() { return UKismetSystemLibrary::GetGameTimeInSeconds(this) - LastTriggerGameTime >= ImpactAudioData.RetriggerCooldown; }
-	FORCEINLINE bool IsImpulseAllow(float QueryImpulse) { return QueryImpulse > ImpactAudioData.ImpactMagnitudeThresholdMin; }
 	FORCEINLINE void UpdateLastTriggerStatus(FTransform InLastTransform) { LastTriggerTransform = InLastTransform; LastTriggerGameTime = UKismetSystemLibrary::GetGameTimeInSeconds(this); }
-	bool IsTriggerDeltaThreshold();
+
+	/* Owner moved past the location or rotation delta threshold since the last trigger. */
+	bool HasMovedSinceLastTrigger() const;
 
 public:	
 
@@ -164,4 +221,15 @@ public:
 
 	UPROPERTY(BlueprintAssignable, Category = "Components|CollisionAudio")
 	FOnPlayCollisionSound OnPlayCollisionSound;
+
+	/* Play the strongest contact accumulated this frame, called by the subsystem after physics. */
+	void ResolvePendingImpact();
+
+	/* Hit of @NormalImpulse at @Location on one of our components, routed contacts come in here from the subsystem. */
+	void HandleImpact(FVector NormalImpulse, FVector Location);
+
+	FORCEINLINE TArray<TWeakObjectPtr<UPrimitiveComponent>> const& GetNotifyComponents() const { return NotifyComponents; }
+
+	// FPhysicalAudioVoiceRequester
+	virtual void StartBudgetedVoice(const FPhysicalAudioVoiceRequest& Request) override;
 };
@@ -4,6 +4,10 @@
 
 #include "ModuleManager.h"
 
+DECLARE_LOG_CATEGORY_EXTERN(LogPhysicalAudio, Log, All);
+
+class FPhysicalAudioPresetRegistry;
+
 class FPhysicalAudioModule : public IModuleInterface
 {
 public:
@@ -11,4 +15,8 @@ public:
 	/** IModuleInterface implementation */
 	virtual void StartupModule() override;
 	virtual void ShutdownModule() override;
+
+private:
+	/* Shared presets, alive between StartupModule and ShutdownModule. */
+	TUniquePtr<FPhysicalAudioPresetRegistry> PresetRegistry;
 };
\ No newline at end of file
@@ -0,0 +1,62 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "PhysicalAudioBenchmarkCommandlet.generated.h"
+
+class UDataTable;
+class USkeletalMesh;
+class UStaticMesh;
+class UPhysicalAudioComponent;
+class UCollisionAudioComponent;
+
+/*
+* Headless benchmark of the physical audio tick, meant to run with -nullrhi -nosound.
+* Spawns tracked and colliding actors in a transient game world, drives them with scripted motion and impacts
+* for a fixed number of frames and writes ms/frame percentiles, allocations and submitted sounds as JSON.
+*
+* UE4Editor-Cmd <Project> -run=PhysicalAudioBenchmark -nullrhi -nosound
+*	-BoneTable=<FPhysicalAudioData table> -BoneRow=<Name> [-SkeletalMesh=<Asset>] [-StaticMesh=<Asset>]
+*	[-ImpactTable=<FCollisionAudioImpactData table> -ImpactRow=<Name>]
+*	[-Skeletal=64] [-Custom=256] [-Colliders=256] [-ImpactRate=0.2] [-ImpulseScale=1.25] [-Frames=600] [-Warmup=60] [-Seed=0]
+*	[-Output=<Json>] [-Baseline=<Json> [-Tolerance=0.1]]
+*
+* Returns 1 when a p95 timing regressed past the tolerance of the baseline.
+*/
+UCLASS()
+class PHYSICALAUDIO_API UPhysicalAudioBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UPhysicalAudioBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	/* Actors of one tracking mode or colliders, all moved by the same script. */
+	struct FBenchmarkActor
+	{
+		AActor* Actor;
+		UPhysicalAudioComponent* PhysicalAudio;
+		UCollisionAudioComponent* CollisionAudio;
+		FVector Origin;
+		float Phase;
+	};
+
+	void SpawnActors(UWorld* World, const FString& Params);
+
+	/* Move every actor and custom bone for @Time, returns the time spent raising impacts. */
+	double DriveFrame(float Time, float DeltaTime);
+
+	TArray<FBenchmarkActor> BenchmarkActors;
+
+	FRandomStream Random;
+
+	/* Chance of a collider getting hit each frame. */
+	float ImpactRate;
+
+	/* Largest impulse, relative to the impact row's ImpactMagnitudeThresholdMax. */
+	float ImpulseScale;
+};
@@ -0,0 +1,129 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "UObject/WeakObjectPtr.h"
+
+class FArchive;
+class UPhysicalAudioComponent;
+class UCollisionAudioComponent;
+struct FPhysicalAudioFrameContext;
+
+/*
+* Records the input of physical audio for a reproducible replay: the frame time steps, the transforms or body velocities
+* every updated bone slot was filtered with and the hits reaching UCollisionAudioComponent::HandleImpact.
+* Replaying feeds them back instead of the poses and hits of the running simulation, so the same capture always
+* produces the same deltas, events and voice requests.
+*
+* "pa.Capture.Record <File>", "pa.Capture.Replay <File>" and "pa.Capture.Stop" from the console.
+* Components are matched by path name, replay in the map the capture was recorded in.
+* NOTE: Game thread only. Significance ranking and rigid body sleep are suspended while capturing, neither is reproducible.
+*
+* File layout: header then one chunk per entry, all little endian:
+*	Frame	DeltaTime, TimeDilation
+*	Name	Id, path name of a component, before its first use
+*	Bones	Id, count, then per slot: Slot, OldPosition, NewPosition, OldRotation, NewRotation
+*			(body velocity slots store their velocity as NewPosition)
+*	Hit		Id, NormalImpulse, Location
+*/
+class PHYSICALAUDIO_API FPhysicalAudioCapture
+{
+public:
+	static FPhysicalAudioCapture& Get();
+
+	FORCEINLINE bool IsRecording() const { return Writer != nullptr; }
+	FORCEINLINE bool IsReplaying() const { return bIsReplaying; }
+	FORCEINLINE bool IsActive() const { return IsRecording() || IsReplaying(); }
+
+	/* Hits coming from the driver while replaying, every other hit is dropped. */
+	FORCEINLINE bool IsInjectingHits() const { return bInjectingHits; }
+
+	bool StartRecording(const FString& FileName);
+	bool StartReplay(const FString& FileName);
+	void Stop();
+
+	/*
+	* Start of a subsystem tick. Recording writes the frame, replaying overrides @InOutContext with the recorded
+	* frame and raises its hits. A replay stops by itself after its last frame.
+	*/
+	void BeginFrame(FPhysicalAudioFrameContext& InOutContext);
+
+	/* Replaying: write the recorded transforms of @Component's slots due this frame, after PrepareTracking. */
+	void ReplayTrackedBones(UPhysicalAudioComponent* Component);
+
+	/* Recording: write the transforms @Component's updated slots were filtered with, after EvaluateTracking. */
+	void RecordTrackedBones(UPhysicalAudioComponent* Component);
+
+	void RecordHit(UCollisionAudioComponent* Component, const FVector& NormalImpulse, const FVector& Location);
+
+private:
+	FPhysicalAudioCapture();
+
+	enum class EChunk : uint8
+	{
+		Frame,
+		Name,
+		Bones,
+		Hit
+	};
+
+	struct FSlotRecord
+	{
+		uint16 Slot;
+		FVector OldPosition;
+		FVector NewPosition;
+		FQuat OldRotation;
+		FQuat NewRotation;
+	};
+
+	struct FBonesRecord
+	{
+		uint32 Id;
+		int32 FirstSlot;
+		int32 NumSlots;
+	};
+
+	struct FHitRecord
+	{
+		uint32 Id;
+		FVector NormalImpulse;
+		FVector Location;
+	};
+
+	struct FFrameRecord
+	{
+		float DeltaTime;
+		float TimeDilation;
+		int32 FirstBones;
+		int32 NumBones;
+		int32 FirstHit;
+		int32 NumHits;
+	};
+
+	/* Id of @Object in this recording, writes its name chunk the first time. */
+	uint32 GetRecordId(UObject* Object);
+
+	/* Replayed object of a recorded id, found by path name once. */
+	UObject* ResolveReplayId(uint32 Id);
+
+	bool LoadReplay(const FString& FileName);
+
+	// Recording
+	FArchive* Writer;
+	TMap<TWeakObjectPtr<UObject>, uint32> RecordIds;
+
+	// Replaying, the whole capture is parsed up front
+	bool bIsReplaying;
+	bool bInjectingHits;
+	bool bReportedDivergence;
+	int32 ReplayFrame;
+	TArray<FFrameRecord> Frames;
+	TArray<FBonesRecord> Bones;
+	TArray<FSlotRecord> Slots;
+	TArray<FHitRecord> Hits;
+	TArray<FString> ReplayNames;
+	TArray<TWeakObjectPtr<UObject>> ReplayObjects;
+
+	/* Bone record of the current replay frame by component, filled in BeginFrame. */
+	TMap<const UObject*, int32> FrameBones;
+};
@@ -5,27 +5,23 @@
 #include "Components/ActorComponent.h"
 #include "Engine/DataTable.h"
 #include "Components/SceneComponent.h"
+#include "PhysicalAudioVoiceBudget.h"
+#include "PhysicalAudioCore.h"
+#include "PhysicalAudioEvents.h"
 #include "PhysicalAudioComponent.generated.h"
 
 class UAudioComponent;
 class UDataTable;
 class UPhysicalAudioComponent;
+class UPhysicalAudioSubsystem;
+struct FPhysicalAudioFrameContext;
+struct FPhysicalAudioBonePreset;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnLoopSoundTriggered, UAudioComponent*, Sound);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnLoopSoundModulated, UAudioComponent*, Sound, float, Intensity);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnMediumSoundTriggered, UAudioComponent*, Sound, float, Intensity);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnHeavySoundTriggered, UAudioComponent*, Sound);
 
-UENUM()
-enum class ETrackedBoneEvent : uint8
-{
-	None,
-	SlowThresholdStart,
-	SlowThresholdStop,
-	MediumThreshold,
-	FastThreshold
-};
-
 UENUM(BlueprintType)
 enum class ETrackedBoneSpace : uint8
 {
@@ -41,6 +37,24 @@ enum class ETrackedBoneVelocityType : uint8
 	Custom
 };
 
+/* How much tracking a component gets, from its listener distance relative to its audible distance. */
+UENUM(BlueprintType)
+enum class EPhysicalAudioSignificance : uint8
+{
+	/* Every tracked bone, every frame. */
+	Full,
+	/* Only bones marked important, every bone if none is. */
+	ImportantOnly,
+	/* Only bones marked important (every bone if none is), updated every few frames. */
+	Throttled,
+	/* Not updated, loop layers stopped. */
+	Dormant
+};
+
+/*
+* Shared, read-only tracking config of a bone, authored in FPhysicalAudioData rows.
+* Per-instance simulation state lives in FTrackedBoneState.
+*/
 USTRUCT(BlueprintType)
 struct FTrackedBone
 {
@@ -48,33 +62,20 @@ struct FTrackedBone
 
 	FTrackedBone();
 
-#if WITH_EDITORONLY_DATA
-	ETrackedBoneEvent Update(UPhysicalAudioComponent* Owner, USkeletalMeshComponent* Mesh, float DeltaTime, float TimeDilation, bool bIgnoreDilation, float InterpSpeed, float VolumeMultiplier, bool DebugOn);
-#else
-	ETrackedBoneEvent Update(USkeletalMeshComponent* Mesh, float DeltaTime, float TimeDilation, bool bIgnoreDilation, float InterpSpeed, float VolumeMultiplier);
-#endif
-
-	float GetRangeMappedDelta(float Left, float Right);
-	void GetCurrentDeltaFromMesh(USkeletalMeshComponent* Mesh);
-	void GetCurrentDeltaFromTransform(FTransform const& Transform);
-	void ResetLoop();
-
-	UPhysicalAudioComponent* Controller;
-
 	// Name of the Bone to track
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	FName BoneName;
 
 	// Sound cues to be triggered when velocity
-	// deltas are discovered
+	// deltas are discovered, streamed in while a component uses the row
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
-	USoundBase* SoundCueLoop;
+	TAssetPtr<USoundBase> SoundCueLoop;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
-	USoundBase* SoundCueMedium;
+	TAssetPtr<USoundBase> SoundCueMedium;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
-	USoundBase* SoundCueHigh;
+	TAssetPtr<USoundBase> SoundCueHigh;
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	float ThresholdLoop;
@@ -97,34 +98,110 @@ struct FTrackedBone
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	ETrackedBoneVelocityType VelocityTrackingType;
 
-	UPROPERTY()
-	UAudioComponent* LoopInstance;
+	// Still tracked when the component is far from the listener, see EPhysicalAudioSignificance. A row without any important bone tracks them all
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bImportant;
 
-	UPROPERTY(BlueprintReadOnly)
-	float Delta;
+	// Updates per second, velocity is measured over the real time between two updates. 0 to update every frame
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.0"))
+	float UpdateRate;
 
-private:
+	// Linear or Rotational: read the world velocity of the bone's physics body instead of differencing its transforms.
+	// Thresholds are in cm/s or rad/s. Bodies that don't simulate read zero, bones without a body use their transforms.
+	// World TrackingSpace only, Relative slots keep using their transforms
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bUseBodyVelocity;
+};
+
+/*
+* Per-instance simulation state of the tracked bones in structure-of-arrays layout.
+* Every array holds one entry per bone slot, the slot being the index of the bone in FPhysicalAudioData::TrackedBones.
+*/
+USTRUCT()
+struct FTrackedBoneState
+{
+	GENERATED_USTRUCT_BODY()
 
-	ETrackedBoneEvent SendEvent(ETrackedBoneEvent Event);
+	void Reset(int32 NumSlots);
 
-	float TimeSinceLastTrigger;
-	bool bTriggeredLoopLayer;
-	float InterpolatedVolume;
-	bool bDirectionChangedSinceLastTrigger;
+	/* Heap size of the slot arrays. */
+	SIZE_T GetAllocatedSize() const;
 
-	// Data required for rotational velocity tracking
-	FQuat TorqueCurrent;
-	FQuat TorqueFinal;
-	FQuat OldRotation;
-	FQuat NewRotation;
-	FQuat PreviousTriggerQuat;
+	FORCEINLINE int32 Num() const { return Deltas.Num(); }
+
+	float GetRangeMappedDelta(int32 Slot, float Left, float Right) const;
+	void GetCurrentDeltaFromMesh(int32 Slot, FTrackedBone const& Bone, USkeletalMeshComponent* Mesh);
+	void GetCurrentDeltaFromPose(int32 Slot, ETrackedBoneSpace Space, TArray<FTransform> const& ComponentSpaceTransforms, FTransform const& ComponentTransform);
+	void GetCurrentDeltaFromTransform(int32 Slot, FTransform const& Transform);
+	/* Reads the physics body, game thread only. */
+	void GetCurrentVelocityFromBody(int32 Slot, USkeletalMeshComponent const* Mesh);
+	void ResetLoop(int32 Slot, UPhysicalAudioSubsystem* Pool);
+
+	// Velocity tracking type in use, non skeletal meshes force Custom
+	TArray<ETrackedBoneVelocityType> VelocityTypes;
+
+	// Skeletal mesh bone index resolved from the bone name, INDEX_NONE for Custom or unresolved slots
+	TArray<int32> BoneIndices;
+
+	// Slots that are updated, unresolved bones are left out until the next resolve
+	TArray<int32> ActiveSlots;
+
+	// Update scheduling from FTrackedBone::UpdateRate, 0 interval for every frame.
+	// PendingTimes is the slot's phase, it starts at the stagger offset and keeps the remainder of each interval
+	TArray<float> UpdateIntervals;
+	TArray<float> PendingTimes;
+
+	// Real time since the slot was last sampled, independent of the phase
+	TArray<float> TimesSinceSample;
+
+	// Real time covered by the current update of a due slot
+	TArray<float> ElapsedTimes;
 
 	// Data required for linear velocity tracking
-	FVector ForceCurrent;
-	FVector ForceFinal;
-	FVector OldPosition;
-	FVector NewPosition;
-	FVector PreviousTriggerVector;
+	TArray<FVector> OldPositions;
+	TArray<FVector> NewPositions;
+	TArray<FVector> FilteredForces;
+	TArray<FVector> PreviousTriggerVectors;
+
+	// Data required for rotational velocity tracking
+	TArray<FQuat> OldRotations;
+	TArray<FQuat> NewRotations;
+	TArray<FQuat> FilteredTorques;
+
+	// Physics body index of bUseBodyVelocity slots, INDEX_NONE for slots tracked from transforms
+	TArray<int32> BodyIndices;
+
+	// Velocity read from the body of a body slot in PrepareTracking, filtered into FilteredForces
+	TArray<FVector> BodyVelocities;
+
+	// Filtered velocity delta of the last update
+	TArray<float> Deltas;
+
+	// Hot copies of the config thresholds, compared in batch against Deltas
+	TArray<float> ThresholdsLoop;
+	TArray<float> ThresholdsMedium;
+	TArray<float> ThresholdsHigh;
+
+	TArray<float> TimesSinceLastTrigger;
+	TArray<float> InterpolatedVolumes;
+
+	// Loop volume last sent to the audio thread and when, and the volume of the last modulation, see LoopVolumeDeadband
+	TArray<float> PushedLoopVolumes;
+	TArray<float> LoopPushTimes;
+	TArray<float> PreviousLoopVolumes;
+	TBitArray<> DirectionChangedSinceLastTrigger;
+
+	UPROPERTY(Transient)
+	TArray<UAudioComponent*> LoopInstances;
+
+	// Per update scratch: due active slots, slots fed to the filter kernels and threshold crossing bitmasks
+	TArray<int32> DueSlots;
+	TArray<int32> LinearSlots;
+	TArray<int32> RotationalSlots;
+	TArray<int32> BodySlots;
+	TArray<uint32> AboveLoopMask;
+	TArray<uint32> AboveMediumMask;
+	TArray<uint32> AboveHighMask;
 };
 
 USTRUCT(BlueprintType)
@@ -136,6 +213,31 @@ struct FPhysicalAudioData : public FTableRowBase
 
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	TArray<FTrackedBone> TrackedBones;
+
+	// Loop volume changes smaller than this are held back until the volume settles
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.0"))
+	float LoopVolumeDeadband;
+
+	// Most loop volume updates per second sent to the audio thread, 0 for no limit
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, meta = (ClampMin = "0.0"))
+	float LoopUpdateRate;
+};
+
+/* Event thrown by a tracked bone slot during evaluation, applied later on the game thread. */
+struct FTrackedBoneEventRecord
+{
+	FTrackedBoneEventRecord(int32 InSlot, ETrackedBoneEvent InEvent, float InIntensity)
+		: Slot(InSlot)
+		, Event(InEvent)
+		, Intensity(InIntensity)
+	{
+	}
+
+	int32 Slot;
+	ETrackedBoneEvent Event;
+
+	// Range mapped delta for one-shots, interpolated volume for LoopModulated
+	float Intensity;
 };
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnCustomTrackedTick, const FTrackedBone&, TrackedBone);
@@ -145,10 +247,13 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnCustomTrackedTick, const FTracked
 * HACK: For static mesh use custom mode and update tracking transform in tick function. 
 */
 UCLASS(ClassGroup = (PhysicalAudio), meta = (BlueprintSpawnableComponent))
-class PHYSICALAUDIO_API UPhysicalAudioComponent : public USceneComponent
+class PHYSICALAUDIO_API UPhysicalAudioComponent : public USceneComponent, public FPhysicalAudioVoiceRequester
 {
 	GENERATED_BODY()
 
+	friend class UPhysicalAudioBenchmarkCommandlet;
+	friend class FPhysicalAudioCapture;
+
 protected:
 	/* Data table row's name configured in @DataTableAsset. */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
@@ -172,8 +277,14 @@ protected:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
 	uint32 bIsSkeletalMesh : 1;
 
-	UPROPERTY(BlueprintReadOnly)
-	TArray<FTrackedBone> TrackedBones;
+	/* Shared config of the tracked bones, see FPhysicalAudioPresetRegistry. */
+	TSharedPtr<const FPhysicalAudioBonePreset> Preset;
+
+	/* Preset's tracked bones, null without a preset. */
+	TArray<FTrackedBone> const* TrackedBones;
+
+	UPROPERTY(Transient)
+	FTrackedBoneState BoneState;
 
 	UPROPERTY(BlueprintReadOnly)
 	class UMeshComponent* Mesh;
@@ -190,8 +301,50 @@ public:
 	// Called when the game starts
 	virtual void BeginPlay() override;
 
-	// Called every frame
-	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/*
+	* Tracking is ticked by UPhysicalAudioSubsystem in three phases every frame:
+	* PrepareTracking and ApplyTrackingEvents run on the game thread, EvaluateTracking may run on any thread
+	* and only touches this component's tracked state.
+	*/
+	void PrepareTracking(const FPhysicalAudioFrameContext& Context);
+	void EvaluateTracking(const FPhysicalAudioFrameContext& Context, TArray<FTrackedBoneEventRecord>& OutEvents);
+	void ApplyTrackingEvents(TArray<FTrackedBoneEventRecord> const& Events);
+
+	/* Record the bone slots updated this frame into FPhysicalAudioTrace. Game thread only. */
+	void TraceTrackingState() const;
+
+#if WITH_EDITORONLY_DATA
+	/* Draw the moving bone slots when bEnableDebug, every frame the component is tracked. Game thread only. */
+	void DrawTrackingDebug();
+#endif
+
+	FORCEINLINE bool IsTrackingActive() const { return bCanPlay && Mesh != nullptr; }
+
+	/* Switch tracking level, dropped slots stop their loop layers. Game thread only. */
+	void SetSignificance(EPhysicalAudioSignificance NewSignificance);
+
+	UFUNCTION(BlueprintPure, Category = "Components|PhysicalAudio")
+	EPhysicalAudioSignificance GetSignificance() const { return Significance; }
+
+	/* Too far to be heard or asleep, the subsystem skips tracking. */
+	FORCEINLINE bool IsDormant() const { return Significance == EPhysicalAudioSignificance::Dormant || bIsAsleep; }
+
+	FORCEINLINE bool IsAsleep() const { return bIsAsleep; }
+
+	/*
+	* Cheap check of a sleeping component, every pa.Sleep.ProbeInterval seconds. Game thread only.
+	* This is what wakes us for bodies created without bGenerateWakeEvents, OnMeshWake only hears the others.
+	* OnCustomTrackedTick keeps firing every frame while asleep, Custom slots wake us when BP moves them.
+	*/
+	void ProbeWake(float DeltaTime);
+
+	/* Where our sounds play from, the tracked mesh since we detach from it in BeginPlay. */
+	FVector GetTrackedLocation() const;
+
+	/* Largest audible distance of the tracked sounds, WORLD_MAX when one of them is not attenuated or still loading. */
+	float GetMaxAudibleDistance() const;
 
 	UFUNCTION(BlueprintCallable, Category = "Components|PhysicalAudio")
 	void SetCanPlay(bool CanPlay);
@@ -202,6 +355,14 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Components|PhysicalAudio")
 	void SetCustomTrackedTransform(int32 Index, FTransform const& Transform);
 
+	/* Filtered velocity delta of a tracked bone from the last update. */
+	UFUNCTION(BlueprintCallable, Category = "Components|PhysicalAudio")
+	float GetTrackedBoneDelta(int32 Index) const;
+
+	/* Copy of the tracked bone config, indexed like GetTrackedBoneDelta. Empty without a data table row. */
+	UFUNCTION(BlueprintCallable, Category = "Components|PhysicalAudio")
+	TArray<FTrackedBone> GetTrackedBones() const;
+
 	UPROPERTY(BlueprintAssignable, Category = "Physics Audio")
 	FOnCustomTrackedTick OnCustomTrackedTick;
 
@@ -211,18 +372,108 @@ public:
 	UPROPERTY(BlueprintAssignable, Category = "Physics Audio")
 	FOnLoopSoundModulated OnLoopSoundModulated;
 
+	/* The audio component is the listener's, never pooled, and destroys itself once finished. */
 	UPROPERTY(BlueprintAssignable, Category = "Physics Audio")
 	FOnMediumSoundTriggered OnMediumSoundTriggered;
 
+	/* The audio component is the listener's, never pooled, and destroys itself once finished. */
 	UPROPERTY(BlueprintAssignable, Category = "Physics Audio")
 	FOnHeavySoundTriggered OnHeavySoundTriggered;
 
+	// FPhysicalAudioVoiceRequester
+	virtual void StartBudgetedVoice(const FPhysicalAudioVoiceRequest& Request) override;
+
 private:
 
-	UAudioComponent* PlaySoundFromBone(FTrackedBone const& VTS, USoundBase* Sound, float Volume, bool UseAttachedAudioComponent = false);
+	/* Play the medium/heavy one-shot of a slot and notify listeners. */
+	void PlayOneShot(int32 Slot, ETrackedBoneEvent Event, float Volume);
+
+	FVector GetSlotLocation(int32 Slot) const;
+
+	/* Add an event of @Slot to the subsystem's frame batch, see UPhysicalAudioSubsystem::OnEvents. */
+	void AddFrameEvent(int32 Slot, EPhysicalAudioEventType Type, float Intensity);
+
+	/* Resolve bone names to indices for the current skeletal mesh asset and LOD, and rebuild the active slots. */
+	void ResolveBoneIndices(USkeletalMeshComponent* SktMesh);
+
+	/* Whether @Slot is tracked at the current significance. */
+	bool IsSlotSignificant(int32 Slot) const;
+
+	/* OnCustomTrackedTick for the Custom slots among @Slots. */
+	void BroadcastCustomTrackedTick(TArray<int32> const& Slots);
+
+	/* Stop tracking until a body wakes up or the mesh moves again, loop layers are released. */
+	void Sleep();
+	void Wake();
+
+	UFUNCTION()
+	void OnMeshSleep(UPrimitiveComponent* SleepingComponent, FName BoneName);
+
+	UFUNCTION()
+	void OnMeshWake(UPrimitiveComponent* WakingComponent, FName BoneName);
+
+	/* Pick the active slots whose update is due this frame, see FTrackedBone::UpdateRate. */
+	void ScheduleTrackedBones(float ElapsedTime);
+
+	/* Spread slots of the same rate over different frames. */
+	float GetStaggerOffset(int32 Slot) const;
+
+	/* Poll transforms or body velocities and filter velocities of every due slot in batch. */
+	void UpdateTrackedBones(USkeletalMeshComponent const* SktMesh, float MaxStep, float TimeScale);
+
+	/* Threshold state machine and loop modulation of one slot, after UpdateTrackedBones. */
+	ETrackedBoneEvent EvaluateTrackedBone(int32 Slot, float NewDeltaTime);
+
+	ETrackedBoneEvent SendEvent(int32 Slot, ETrackedBoneEvent Event);
+
+	/* @bPooled false spawns a component of its own that destroys itself once finished, for components handed to listeners. */
+	UAudioComponent* PlaySoundFromBone(int32 Slot, const TAssetPtr<USoundBase>& SoundAsset, float Volume, bool UseAttachedAudioComponent = false, bool bPooled = true);
 
 	void ResetDataFromTable();
 
+	/* Report the heap size of BoneState to the tracked state memory stat. */
+	void UpdateTrackedStateMemory();
+
+	UPhysicalAudioSubsystem* GetSubsystem();
+
+	UPROPERTY(Transient)
+	UPhysicalAudioSubsystem* Subsystem;
+
+	/* Skeletal mesh asset and LOD the bone indices were resolved against. */
+	UPROPERTY(Transient)
+	USkeletalMesh* ResolvedSkeletalMesh;
+
+	int32 ResolvedLODLevel;
+
+	EPhysicalAudioSignificance Significance;
+
+	/* Time and frames since the last evaluation, while throttled. */
+	float PendingDeltaTime;
+	int32 PendingFrames;
+
+	/* Set in PrepareTracking when this frame's EvaluateTracking should run. */
+	bool bEvaluatePending;
+
+	/* Active slots were added or woke up, their previous transforms are stale. */
+	bool bPrimeTracking;
+
+	/* Transforms of this frame's due slots come from FPhysicalAudioCapture, the mesh pose is not read. */
+	bool bReplayingInput;
+
+	/* Stagger phase from the path name, stable across runs so captures replay on the same schedule. */
+	uint32 StaggerSeed;
+
+	/* All bodies asleep or nothing moved for pa.Sleep.QuietUpdates updates. */
+	bool bIsAsleep;
+
+	/* Consecutive updates without any delta nor playing loop. */
+	int32 QuietUpdates;
+
+	float TimeSinceWakeProbe;
+
+	/* BoneState size last reported to "stat PhysicalAudio". */
+	SIZE_T TrackedStateMemory;
+
 	bool bCanPlay;
 
 	float VolumeMultiplier;
@@ -0,0 +1,226 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+/*
+* Tracking and impact trigger logic, kept free of engine types so it compiles with nothing but the standard library.
+* UPhysicalAudioComponent and UCollisionAudioComponent gather their state into these and act on the result.
+*/
+
+enum class ETrackedBoneEvent : uint8_t
+{
+	None,
+	SlowThresholdStart,
+	SlowThresholdStop,
+	MediumThreshold,
+	FastThreshold,
+	LoopModulated
+};
+
+namespace PhysicalAudioCore
+{
+	/* @Value remapped from [Left, Right] to [0, 1], clamped. */
+	inline float MapRangeClamped(float Value, float Left, float Right)
+	{
+		const float Alpha = (Value - Left) / (Right - Left);
+		return Alpha < 0.f ? 0.f : (Alpha > 1.f ? 1.f : Alpha);
+	}
+
+	/*
+	* One velocity filter step on a value of @Num floats: Velocity = (New - Old) / DeltaTime,
+	* Filtered += (Velocity - Filtered) * DeltaTime * InterpSpeed. Returns the size of the pre-filter delta.
+	*/
+	inline float FilterVelocity(const float* OldValue, const float* NewValue, float* InOutFiltered, int32_t Num, float DeltaTime, float InterpSpeed)
+	{
+		const float Blend = DeltaTime * InterpSpeed;
+
+		float SizeSquared = 0.f;
+		for (int32_t Index = 0; Index < Num; ++Index)
+		{
+			const float Velocity = (NewValue[Index] - OldValue[Index]) / DeltaTime;
+			const float Delta = Velocity - InOutFiltered[Index];
+
+			InOutFiltered[Index] += Delta * Blend;
+			SizeSquared += Delta * Delta;
+		}
+
+		return std::sqrt(SizeSquared);
+	}
+
+	/* FilterVelocity on a velocity read directly, from a physics body for example. */
+	inline float FilterMeasuredVelocity(const float* Velocity, float* InOutFiltered, int32_t Num, float DeltaTime, float InterpSpeed)
+	{
+		const float Blend = DeltaTime * InterpSpeed;
+
+		float SizeSquared = 0.f;
+		for (int32_t Index = 0; Index < Num; ++Index)
+		{
+			const float Delta = Velocity[Index] - InOutFiltered[Index];
+
+			InOutFiltered[Index] += Delta * Blend;
+			SizeSquared += Delta * Delta;
+		}
+
+		return std::sqrt(SizeSquared);
+	}
+
+	/*
+	* Whether a Custom slot set to @NewLocation and @NewRotation wakes its sleeping component, @Location and @Rotation
+	* being what BP last set it to. Per component within @Tolerance is still, rotations compare up to sign.
+	*/
+	inline bool ShouldWakeOnCustomTransform(bool bIsAsleep, const float* Location, const float* Rotation, const float* NewLocation, const float* NewRotation, float Tolerance)
+	{
+		if (!bIsAsleep)
+		{
+			return false;
+		}
+
+		for (int32_t Index = 0; Index < 3; ++Index)
+		{
+			if (std::fabs(NewLocation[Index] - Location[Index]) > Tolerance)
+			{
+				return true;
+			}
+		}
+
+		bool bSameRotation = true;
+		bool bNegatedRotation = true;
+		for (int32_t Index = 0; Index < 4; ++Index)
+		{
+			bSameRotation = bSameRotation && std::fabs(NewRotation[Index] - Rotation[Index]) <= Tolerance;
+			bNegatedRotation = bNegatedRotation && std::fabs(NewRotation[Index] + Rotation[Index]) <= Tolerance;
+		}
+
+		return !bSameRotation && !bNegatedRotation;
+	}
+
+	/* Everything the threshold state machine looks at for one bone slot. */
+	struct FBoneTriggerInput
+	{
+		bool bAboveLoop;
+		bool bAboveMedium;
+		bool bAboveHigh;
+
+		bool bHasLoopSound;
+		bool bHasMediumSound;
+		bool bHasHighSound;
+
+		/* A loop instance is playing on the slot. */
+		bool bLoopPlaying;
+		float InterpolatedVolume;
+
+		float TimeSinceLastTrigger;
+		float RetriggerDelay;
+
+		/* Direction flipped since the last one-shot, lifts the retrigger delay. */
+		bool bDirectionChanged;
+	};
+
+	/*
+	* Event of a bone slot this step. Loop start/stop take precedence over one-shots,
+	* LoopModulated means the playing loop only needs its volume moved, see InterpolateLoopVolume.
+	*/
+	inline ETrackedBoneEvent EvaluateThresholds(const FBoneTriggerInput& Input)
+	{
+		if (Input.bAboveLoop)
+		{
+			if (!Input.bLoopPlaying && Input.bHasLoopSound)
+			{
+				return ETrackedBoneEvent::SlowThresholdStart;
+			}
+		}
+		else if (std::fabs(Input.InterpolatedVolume) <= 1.e-8f)
+		{
+			if (Input.bLoopPlaying)
+			{
+				return ETrackedBoneEvent::SlowThresholdStop;
+			}
+		}
+
+		if (Input.TimeSinceLastTrigger >= Input.RetriggerDelay || Input.bDirectionChanged)
+		{
+			if (Input.bAboveMedium && !Input.bAboveHigh && Input.bHasMediumSound)
+			{
+				return ETrackedBoneEvent::MediumThreshold;
+			}
+			else if (Input.bAboveHigh && Input.bHasHighSound)
+			{
+				return ETrackedBoneEvent::FastThreshold;
+			}
+		}
+
+		return Input.bLoopPlaying ? ETrackedBoneEvent::LoopModulated : ETrackedBoneEvent::None;
+	}
+
+	/* One-shots restart the retrigger delay, loop start/stop don't. */
+	inline bool RestartsRetriggerDelay(ETrackedBoneEvent Event)
+	{
+		return Event == ETrackedBoneEvent::MediumThreshold || Event == ETrackedBoneEvent::FastThreshold;
+	}
+
+	/* Loop volume eased towards @Delta mapped from [ThresholdLoop, ThresholdHigh]. */
+	inline float InterpolateLoopVolume(float Volume, float Delta, float ThresholdLoop, float ThresholdHigh, float DeltaTime, float InterpSpeed)
+	{
+		const float Target = MapRangeClamped(Delta, ThresholdLoop, ThresholdHigh);
+		return Volume + (Target - Volume) * DeltaTime * InterpSpeed;
+	}
+
+	/*
+	* Whether a loop parameter now at @Value is sent to the audio thread, @Pushed being the last value sent and @Previous
+	* the value of the last update. Changes under @Deadband wait until the value stops moving, then snap to it.
+	* Nothing is sent within @MinInterval of the last push.
+	*/
+	inline bool ShouldPushLoopParameter(float Value, float Previous, float Pushed, float Deadband, float TimeSincePush, float MinInterval)
+	{
+		const float Change = std::fabs(Value - Pushed);
+		if (Change <= 1.e-4f || TimeSincePush < MinInterval)
+		{
+			return false;
+		}
+
+		return Change >= Deadband || std::fabs(Value - Previous) <= Deadband * 0.1f;
+	}
+
+	enum class EImpactRejection : uint8_t
+	{
+		None,
+		Impulse,
+		Cooldown,
+		DeltaThreshold
+	};
+
+	struct FImpactGate
+	{
+		float ImpulseThresholdMin;
+		float RetriggerCooldown;
+		float LastTriggerTime;
+
+		/* First hit or delta threshold disabled, the owner doesn't have to have moved. */
+		bool bSkipDeltaThreshold;
+	};
+
+	/*
+	* Why a hit of @ImpulseMagnitude at @Time doesn't play, None if it does.
+	* Cheapest rejections first, @HasMoved() is only asked once everything else passed.
+	*/
+	template<typename HasMovedType>
+	inline EImpactRejection ValidateImpact(const FImpactGate& Gate, float ImpulseMagnitude, float Time, HasMovedType HasMoved)
+	{
+		if (!(ImpulseMagnitude > Gate.ImpulseThresholdMin))
+		{
+			return EImpactRejection::Impulse;
+		}
+		if (Time - Gate.LastTriggerTime < Gate.RetriggerCooldown)
+		{
+			return EImpactRejection::Cooldown;
+		}
+		if (!Gate.bSkipDeltaThreshold && !HasMoved())
+		{
+			return EImpactRejection::DeltaThreshold;
+		}
+		return EImpactRejection::None;
+	}
+}
@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Containers/ArrayView.h"
+#include "PhysicalAudioEvents.generated.h"
+
+class UActorComponent;
+
+UENUM(BlueprintType)
+enum class EPhysicalAudioEventType : uint8
+{
+	LoopStart,
+	LoopStop,
+	/* Loop volume sent to the audio thread, see FPhysicalAudioData::LoopVolumeDeadband. */
+	LoopModulated,
+	Medium,
+	Fast,
+	/* Accepted hit of a UCollisionAudioComponent. */
+	Impact
+};
+
+/* One physical audio event of the frame, the sound may still be dropped by the voice budget. */
+USTRUCT(BlueprintType)
+struct FPhysicalAudioEventRecord
+{
+	GENERATED_USTRUCT_BODY()
+
+	FPhysicalAudioEventRecord()
+		: Component(nullptr)
+		, Slot(INDEX_NONE)
+		, Type(EPhysicalAudioEventType::LoopStart)
+		, Intensity(0.f)
+		, Location(FVector::ZeroVector)
+	{
+	}
+
+	/* UPhysicalAudioComponent or UCollisionAudioComponent that raised the event. */
+	UPROPERTY(BlueprintReadOnly, Category = "Physics Audio")
+	UActorComponent* Component;
+
+	/* Tracked bone slot, INDEX_NONE for impacts. */
+	UPROPERTY(BlueprintReadOnly, Category = "Physics Audio")
+	int32 Slot;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Physics Audio")
+	EPhysicalAudioEventType Type;
+
+	/* Range mapped delta, loop volume or mapped impulse, [0, 1]. */
+	UPROPERTY(BlueprintReadOnly, Category = "Physics Audio")
+	float Intensity;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Physics Audio")
+	FVector Location;
+};
+
+/* Every event of a frame in raise order, only valid during the call. */
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnPhysicalAudioEvents, TArrayView<const FPhysicalAudioEventRecord>);
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnPhysicalAudioEventsDynamic, const TArray<FPhysicalAudioEventRecord>&, Events);
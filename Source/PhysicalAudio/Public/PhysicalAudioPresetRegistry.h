@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "UObject/GCObject.h"
+#include "Engine/StreamableManager.h"
+#include "PhysicalAudioComponent.h"
+#include "CollisionAudioComponent.h"
+
+class UDataTable;
+
+/* Read-only tracked bone config of a FPhysicalAudioData row, shared by every component using the row. */
+struct FPhysicalAudioBonePreset
+{
+	TArray<FTrackedBone> TrackedBones;
+
+	// No bone of the row is marked important, every bone counts as important then
+	bool bAllBonesImportant;
+
+	// Largest audible distance of the attenuated preset sounds, WORLD_MAX when none is or until they are loaded
+	float MaxAudibleDistance;
+
+	// Sounds streamed in for the lifetime of the preset
+	TArray<FStringAssetReference> SoundPaths;
+
+	// Loop volume push throttling, see FPhysicalAudioData::LoopVolumeDeadband
+	float LoopVolumeDeadband;
+	float LoopUpdateInterval;
+};
+
+/* Read-only impact config of a FCollisionAudioImpactData row, shared by every component using the row. */
+struct FCollisionAudioPreset
+{
+	FCollisionAudioImpactData ImpactData;
+
+	// Voice budget cluster of the row, see FPhysicalAudioVoiceRequest::ClusterId
+	uint32 ClusterId;
+
+	TArray<FStringAssetReference> SoundPaths;
+};
+
+/*
+* Resolves each (data table, row) pair once into a ref-counted preset.
+* Presets live as long as a component holds them, the next lookup of a released row resolves it again.
+* Row sounds are requested asynchronously when their preset is created and unloaded once no live preset uses them.
+* NOTE: Game thread only. Rows edited while presets are alive are picked up once every holder released them.
+* Owned by FPhysicalAudioModule, presets released after ShutdownModule no longer touch it.
+*/
+class PHYSICALAUDIO_API FPhysicalAudioPresetRegistry : public FGCObject
+{
+public:
+	/* Only valid while the module is loaded. */
+	static FPhysicalAudioPresetRegistry& Get();
+
+	/* Null if the row doesn't exist. */
+	TSharedPtr<const FPhysicalAudioBonePreset> FindBonePreset(UDataTable* DataTable, FName RowName);
+	TSharedPtr<const FCollisionAudioPreset> FindImpactPreset(UDataTable* DataTable, FName RowName);
+
+	/* The sound if it finished streaming, null otherwise. Callers skip the sound, the miss is logged. */
+	USoundBase* GetLoadedSound(const TAssetPtr<USoundBase>& Sound);
+
+	// FGCObject
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+
+private:
+	friend class FPhysicalAudioModule;
+
+	/* Set by FPhysicalAudioModule for the lifetime of its registry. */
+	static FPhysicalAudioPresetRegistry* Instance;
+
+	struct FPresetKey
+	{
+		FPresetKey(UDataTable* InDataTable, FName InRowName)
+			: DataTable(InDataTable)
+			, RowName(InRowName)
+		{
+		}
+
+		// Kept alive by AddReferencedObjects while the preset is
+		UDataTable* DataTable;
+		FName RowName;
+
+		FORCEINLINE bool operator==(const FPresetKey& Other) const { return DataTable == Other.DataTable && RowName == Other.RowName; }
+		friend FORCEINLINE uint32 GetTypeHash(const FPresetKey& Key) { return HashCombine(PointerHash(Key.DataTable), GetTypeHash(Key.RowName)); }
+	};
+
+	/* Drop the entries of released presets. */
+	void PurgeReleased();
+
+	/* Ref-counted per sound, shared sounds stay loaded while any preset uses them. */
+	void AcquireSounds(const TArray<FStringAssetReference>& SoundPaths, FStreamableDelegate OnLoaded);
+	void ReleaseSounds(const TArray<FStringAssetReference>& SoundPaths);
+
+	/* Deleters of the presets, releasing their sounds. */
+	static void DestroyBonePreset(FPhysicalAudioBonePreset* Preset);
+	static void DestroyImpactPreset(FCollisionAudioPreset* Preset);
+
+	TMap<FPresetKey, TWeakPtr<const FPhysicalAudioBonePreset>> BonePresets;
+	TMap<FPresetKey, TWeakPtr<const FCollisionAudioPreset>> ImpactPresets;
+
+	// Keeps the requested sounds referenced until they are unloaded
+	FStreamableManager StreamableManager;
+	TMap<FStringAssetReference, int32> SoundRefCounts;
+
+	// Sounds that failed to load, only reported once
+	TSet<FStringAssetReference> MissingSounds;
+};
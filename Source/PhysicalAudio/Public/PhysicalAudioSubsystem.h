@@ -0,0 +1,266 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "Engine/EngineBaseTypes.h"
+#include "PhysicalAudioComponent.h"
+#include "PhysicalAudioVoiceBudget.h"
+#include "PhysicalAudioEvents.h"
+#include "PhysicalAudioSubsystem.generated.h"
+
+class UAudioComponent;
+class UCollisionAudioComponent;
+class UPrimitiveComponent;
+class UPhysicalAudioSubsystem;
+
+/* Per-frame values shared by every tracked component, computed once per subsystem tick. */
+struct FPhysicalAudioFrameContext
+{
+	FPhysicalAudioFrameContext()
+		: DeltaTime(0.f)
+		, TimeDilation(1.f)
+		, ThrottledInterval(1)
+	{
+	}
+
+	float DeltaTime;
+	float TimeDilation;
+
+	/* Frames between two updates of a Throttled component. */
+	int32 ThrottledInterval;
+};
+
+/* Running totals of the subsystem work, diff two snapshots to measure a frame. */
+struct FPhysicalAudioSubsystemCounters
+{
+	FPhysicalAudioSubsystemCounters()
+		: TrackingCycles(0)
+		, ApplyCycles(0)
+		, FlushCycles(0)
+		, NumEventsApplied(0)
+		, NumVoicesSubmitted(0)
+	{
+	}
+
+	/* Significance, prepare and evaluate passes of Tick. */
+	uint64 TrackingCycles;
+	/* Event apply pass of Tick. */
+	uint64 ApplyCycles;
+	/* Impact resolve and voice budget of Flush. */
+	uint64 FlushCycles;
+
+	int64 NumEventsApplied;
+	int64 NumVoicesSubmitted;
+};
+
+/* Contact on a routed primitive, buffered until Flush. */
+struct FPhysicalAudioRoutedContact
+{
+	/* Key of the route map, the primitive may be gone by the time the contact is dispatched. */
+	TWeakObjectPtr<UPrimitiveComponent> Primitive;
+
+	FVector NormalImpulse;
+	FVector Location;
+};
+
+UENUM()
+enum class EPhysicalAudioTickStage : uint8
+{
+	/* Bone tracking of the registered components, during physics. */
+	Tracking,
+	/* Budgeted one-shots of the frame, after physics and its hit notifies. */
+	Flush
+};
+
+USTRUCT()
+struct FPhysicalAudioTickFunction : public FTickFunction
+{
+	GENERATED_USTRUCT_BODY()
+
+	FPhysicalAudioTickFunction()
+		: Target(nullptr)
+		, Stage(EPhysicalAudioTickStage::Tracking)
+	{
+	}
+
+	UPhysicalAudioSubsystem* Target;
+
+	EPhysicalAudioTickStage Stage;
+
+	virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+	virtual FString DiagnosticMessage() override;
+};
+
+template<>
+struct TStructOpsTypeTraits<FPhysicalAudioTickFunction> : public TStructOpsTypeTraitsBase
+{
+	enum
+	{
+		WithCopy = false
+	};
+};
+
+/*
+* Per-world owner of the physical audio tick.
+* Components register here instead of ticking themselves, so every tracked bone in the world is updated in one pass.
+* NOTE: Lives in the world's PerModuleDataObjects, use Get() to find or create it.
+*/
+UCLASS(Transient, BlueprintType)
+class PHYSICALAUDIO_API UPhysicalAudioSubsystem : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	UPhysicalAudioSubsystem();
+
+	/* Find or create the subsystem of a game world, returns null for non game worlds. */
+	static UPhysicalAudioSubsystem* Get(UWorld* World);
+
+	UFUNCTION(BlueprintPure, Category = "Physics Audio", meta = (WorldContext = "WorldContextObject", DisplayName = "Get Physical Audio Subsystem"))
+	static UPhysicalAudioSubsystem* GetPhysicalAudioSubsystem(UObject* WorldContextObject);
+
+	/*
+	* Every tracking event and accepted impact of the frame in one call, after the voice budget flush.
+	* Nothing is gathered while neither this nor OnEvents has a listener.
+	*/
+	FORCEINLINE FOnPhysicalAudioEvents& OnEventsNative() { return NativeEvents; }
+
+	UPROPERTY(BlueprintAssignable, Category = "Physics Audio")
+	FOnPhysicalAudioEventsDynamic OnEvents;
+
+	FORCEINLINE bool HasEventListeners() const { return NativeEvents.IsBound() || OnEvents.IsBound(); }
+
+	/* Add an event to this frame's batch, check HasEventListeners first. */
+	FORCEINLINE void RecordEvent(const FPhysicalAudioEventRecord& Record) { FrameEvents.Add(Record); }
+
+	void RegisterComponent(UPhysicalAudioComponent* Component);
+	void UnregisterComponent(UPhysicalAudioComponent* Component);
+
+	void Tick(float DeltaTime);
+
+	/* Resolve coalesced impacts, then start the one-shots admitted by the voice budget. */
+	void Flush(float DeltaTime);
+
+	/* Resolve the contacts @Component accumulated this frame in the next Flush. */
+	void QueueImpact(UCollisionAudioComponent* Component);
+
+	/*
+	* Listen to the hits of @Component's notify components for it, see UCollisionAudioComponent::bRouteHitsThroughSubsystem.
+	* Every routed primitive shares one handler, contacts are dispatched through a primitive to component map in Flush.
+	*/
+	void RegisterImpactRoutes(UCollisionAudioComponent* Component);
+	void UnregisterImpactRoutes(UCollisionAudioComponent* Component);
+
+	/* Set the volume of a playing loop, sent to the audio thread along with every other loop of the frame in Flush. */
+	void QueueLoopVolume(UAudioComponent* AudioComponent, float Volume);
+
+	/* Queue a one-shot for the voice budget of this frame. */
+	void SubmitVoice(const FPhysicalAudioVoiceRequest& Request);
+
+	FORCEINLINE FPhysicalAudioVoiceBudget const& GetVoiceBudget() const { return VoiceBudget; }
+
+	FORCEINLINE FPhysicalAudioSubsystemCounters const& GetCounters() const { return Counters; }
+
+	/*
+	* Take an audio component from the pool, attach it to @AttachTo at @AttachName and start playing @Sound.
+	* Must be handed back through ReleaseAudioComponent, see pa.AudioPool.Capacity.
+	*/
+	UAudioComponent* AcquireAudioComponent(USoundBase* Sound, USceneComponent* AttachTo, FName AttachName, float VolumeMultiplier);
+
+	/*
+	* Hand an acquired audio component back, it returns to the pool once it has finished playing.
+	* Delegate bindings, instance parameters, pitch and attenuation override are reset then.
+	*/
+	void ReleaseAudioComponent(UAudioComponent* AudioComponent);
+
+	virtual void BeginDestroy() override;
+	virtual UWorld* GetWorld() const override;
+
+	static void AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector);
+
+protected:
+	void Initialize(UWorld* InWorld);
+
+	void OnWorldCleanup(UWorld* InWorld, bool bSessionEnded, bool bCleanupResources);
+
+	void OnPooledAudioFinished(UAudioComponent* AudioComponent);
+
+	void ReturnToPool(UAudioComponent* AudioComponent);
+
+	/* Rank registered components by listener distance over audible distance and set their significance. */
+	void UpdateSignificance();
+
+	UFUNCTION()
+	void OnRoutedHit(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit);
+
+	/* Drop the routes of destroyed primitives or collision components, unbinding primitives left without a route. */
+	void PurgeStaleImpactRoutes();
+
+	/* Hand the contacts buffered by OnRoutedHit to their collision components. */
+	void DispatchRoutedContacts();
+
+	/* Apply every queued loop volume with a single audio thread command. */
+	void FlushLoopVolumes();
+
+	/* Idle pooled audio components. */
+	UPROPERTY(Transient)
+	TArray<UAudioComponent*> FreeAudioComponents;
+
+	/* Acquired pooled audio components, released ones stay here until they finish playing. */
+	UPROPERTY(Transient)
+	TSet<UAudioComponent*> ActiveAudioComponents;
+
+	TSet<UAudioComponent*> ReleasedAudioComponents;
+
+	UPROPERTY(Transient)
+	TArray<UPhysicalAudioComponent*> Components;
+
+	/* Collision components with contacts to resolve, see UCollisionAudioComponent::bCoalesceImpacts. */
+	UPROPERTY(Transient)
+	TArray<UCollisionAudioComponent*> PendingImpacts;
+
+	/* Scratch copy so impacts queued while resolving wait for the next flush. */
+	UPROPERTY(Transient)
+	TArray<UCollisionAudioComponent*> ResolvingImpacts;
+
+	/*
+	* Collision components listening to a routed primitive, usually one.
+	* Weak keys so a primitive destroyed without unregistering can't alias a new one at the same address.
+	*/
+	TMultiMap<TWeakObjectPtr<UPrimitiveComponent>, TWeakObjectPtr<UCollisionAudioComponent>> ImpactRoutes;
+
+	/* Contacts on routed primitives since the last Flush. */
+	TArray<FPhysicalAudioRoutedContact> RoutedContacts;
+
+	/* Audio component id and new volume of the loops modulated this frame. */
+	TArray<TPair<uint64, float>> PendingLoopVolumes;
+
+	FOnPhysicalAudioEvents NativeEvents;
+
+	/* Events raised since the last Flush, handed to the listeners at its end. */
+	UPROPERTY(Transient)
+	TArray<FPhysicalAudioEventRecord> FrameEvents;
+
+	UPROPERTY(Transient)
+	TArray<FPhysicalAudioEventRecord> BroadcastEvents;
+
+	FPhysicalAudioTickFunction TickFunction;
+
+	FPhysicalAudioTickFunction FlushTickFunction;
+
+	FPhysicalAudioVoiceBudget VoiceBudget;
+
+	FPhysicalAudioSubsystemCounters Counters;
+
+private:
+	FDelegateHandle WorldCleanupHandle;
+
+	/* Events thrown during evaluation, one buffer per registered component so apply order is deterministic. */
+	TArray<TArray<FTrackedBoneEventRecord>> EventBuffers;
+
+	/* Scratch of UpdateSignificance, listener distance over audible distance per component. */
+	TArray<TPair<float, UPhysicalAudioComponent*>> SignificanceRanking;
+
+	/* Set while iterating Components, registration changes are deferred until the pass ends. */
+	bool bIsTicking;
+};
@@ -0,0 +1,122 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+// Compiled out of shipping builds only, test builds can still capture
+#ifndef PHYSICALAUDIO_TRACE
+#define PHYSICALAUDIO_TRACE !UE_BUILD_SHIPPING
+#endif
+
+#if PHYSICALAUDIO_TRACE
+
+#include "UObject/ObjectKey.h"
+
+enum class EPhysicalAudioTraceType : uint8
+{
+	/* Delta and interpolated volume of a bone slot updated this frame. */
+	BoneSample,
+	/* ETrackedBoneEvent applied on a bone slot. */
+	Event,
+	/* Hit dropped by a collision component, Code is a EPhysicalAudioTraceRejection. */
+	ImpactRejected,
+	/* Hit that went on to play, Value0 is the mapped impulse magnitude. */
+	ImpactAccepted
+};
+
+enum class EPhysicalAudioTraceRejection : uint8
+{
+	Impulse,
+	Cooldown,
+	DeltaThreshold
+};
+
+/* Fixed size binary record, no strings are built while capturing. */
+struct FPhysicalAudioTraceRecord
+{
+	uint64 Frame;
+	float Time;
+	/* Index of the component's name, see FPhysicalAudioTrace::FindTracedComponent. */
+	uint32 ComponentIndex;
+	uint16 Slot;
+	EPhysicalAudioTraceType Type;
+	uint8 Code;
+	float Value0;
+	float Value1;
+};
+
+/*
+* Ring buffer of tracking samples, events and impact decisions, for debugging trigger behavior in test builds.
+* Toggled with pa.Trace.Enable, filtered with pa.Trace.Filter and dumped with "pa.Trace.Export <File>" as CSV.
+* NOTE: Game thread only.
+*/
+class PHYSICALAUDIO_API FPhysicalAudioTrace
+{
+public:
+	static FPhysicalAudioTrace& Get();
+
+	FORCEINLINE bool IsEnabled() const { return bEnabled; }
+
+	/* Whether bone samples are recorded this frame, see pa.Trace.SampleInterval. */
+	bool ShouldSampleBones() const;
+
+	/* Enabled and @Component's owner matches pa.Trace.Filter. */
+	FORCEINLINE bool ShouldTrace(const UObject* Component) { return FindTracedComponent(Component) != INDEX_NONE; }
+
+	/* Index to record @Component's entries with, INDEX_NONE if it isn't traced. */
+	int32 FindTracedComponent(const UObject* Component);
+
+	void Record(int32 ComponentIndex, EPhysicalAudioTraceType Type, int32 Slot, uint8 Code, float Value0, float Value1 = 0.f);
+
+	/* Oldest record first, returns false if the file could not be written. */
+	bool ExportCsv(const FString& FileName) const;
+
+	void Reset();
+
+private:
+	FPhysicalAudioTrace();
+
+	/* Pick up the pa.Trace.* values, a new filter or capacity restarts the capture. */
+	void OnSettingsChanged();
+	static void OnConsoleVariablesChanged();
+
+	/* Forget the filter results of destroyed components. */
+	void PruneFilterResults();
+
+	/* Allocated the first time the trace is enabled. */
+	TArray<FPhysicalAudioTraceRecord> Records;
+
+	/* Next record to write, the buffer wraps once full. */
+	int32 Head;
+	bool bWrapped;
+
+	bool bEnabled;
+	FString Filter;
+	int32 SampleInterval;
+	double StartTime;
+
+	/*
+	* Index into ComponentNames, or INDEX_NONE when filtered out, of every component seen since the filter last changed.
+	* Keyed by object and serial number so a new component reusing a slot of the object array isn't mistaken for a dead one.
+	*/
+	TMap<FObjectKey, int32> FilterResults;
+	int32 PruneThreshold;
+
+	/* Names of the traced components, kept after they are destroyed for the export. */
+	TArray<FString> ComponentNames;
+};
+
+#define PHYSICALAUDIO_TRACE_RECORD(Component, Type, Slot, Code, ...) \
+	do \
+	{ \
+		const int32 TraceComponentIndex = FPhysicalAudioTrace::Get().FindTracedComponent(Component); \
+		if (TraceComponentIndex != INDEX_NONE) \
+		{ \
+			FPhysicalAudioTrace::Get().Record(TraceComponentIndex, Type, Slot, Code, ##__VA_ARGS__); \
+		} \
+	} while (0)
+
+#else
+
+#define PHYSICALAUDIO_TRACE_RECORD(Component, Type, Slot, Code, ...) do {} while (0)
+
+#endif
@@ -0,0 +1,139 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+class USoundBase;
+struct FPhysicalAudioVoiceRequest;
+
+/*
+* Native mixin of the components whose one-shots go through the voice budget, not a UINTERFACE: it is never
+* called from BP and doesn't keep its implementer alive. The budget only calls it while the request's Owner is valid.
+*/
+class PHYSICALAUDIO_API FPhysicalAudioVoiceRequester
+{
+public:
+	virtual ~FPhysicalAudioVoiceRequester() {}
+
+	/* The request was admitted, start the sound now. */
+	virtual void StartBudgetedVoice(const FPhysicalAudioVoiceRequest& Request) = 0;
+};
+
+/* Candidate one-shot sound, scored against the other candidates of the frame. */
+struct FPhysicalAudioVoiceRequest
+{
+	FPhysicalAudioVoiceRequest()
+		: Requester(nullptr)
+		, Sound(nullptr)
+		, Location(FVector::ZeroVector)
+		, Intensity(0.f)
+		, VolumeMultiplier(1.f)
+		, PitchMultiplier(1.f)
+		, Payload(INDEX_NONE)
+		, PayloadEvent(0)
+		, ClusterId(0)
+		, NumMerged(1)
+		, ClusterCellIndex(INDEX_NONE)
+		, Score(0.f)
+	{
+	}
+
+	// Requester is only called while Owner is alive, the component implementing Requester passes itself
+	TWeakObjectPtr<UObject> Owner;
+	FPhysicalAudioVoiceRequester* Requester;
+
+	// Referenced by the budget while queued
+	USoundBase* Sound;
+	FVector Location;
+
+	// Normalized impulse magnitude or velocity delta, [0, 1]
+	float Intensity;
+
+	float VolumeMultiplier;
+	float PitchMultiplier;
+
+	// Requester defined, e.g. the bone slot and event that asked for the sound
+	int32 Payload;
+	uint8 PayloadEvent;
+
+	// Requests with the same non zero id, sound and cell merge into one voice, e.g. impacts of the same table row
+	uint32 ClusterId;
+
+	// Filled in by the budget: requests merged into this one, Intensity is then their combined intensity
+	int32 NumMerged;
+
+	// Filled in by the budget: cluster cell this request leads, its voice is recorded there once admitted
+	int32 ClusterCellIndex;
+
+	float Score;
+};
+
+/*
+* Per-frame and concurrent cap on physical audio one-shots.
+* Requests are queued during the frame and the best scored ones are started on Flush, the rest are dropped
+* before any sound work is done. Scores weigh intensity, listener distance and how recently the owner played.
+* Clustered requests landing in the same spatial hash cell within a short window are merged first, see pa.VoiceBudget.Cluster*.
+*/
+class PHYSICALAUDIO_API FPhysicalAudioVoiceBudget
+{
+public:
+	FPhysicalAudioVoiceBudget();
+
+	/* Queue a request, started right away when budgeting is disabled (pa.VoiceBudget.Enable). */
+	void Submit(const FPhysicalAudioVoiceRequest& Request);
+
+	/* Score and start the admitted requests of this frame. */
+	void Flush(UWorld* World);
+
+	void Reset();
+
+	/* Queued sounds stay loaded until their request is flushed, whatever happens to the preset that asked. */
+	void AddReferencedObjects(FReferenceCollector& Collector);
+
+	FORCEINLINE int32 GetNumPending() const { return PendingRequests.Num(); }
+	FORCEINLINE int32 GetNumAdmittedLastFlush() const { return NumAdmittedLastFlush; }
+	FORCEINLINE int32 GetNumRejectedLastFlush() const { return NumRejectedLastFlush; }
+	FORCEINLINE int32 GetNumRejectedTotal() const { return NumRejectedTotal; }
+	FORCEINLINE int32 GetNumMergedLastFlush() const { return NumMergedLastFlush; }
+
+private:
+	/* Open addressing entry of the cluster hash, one per cell, cluster id and sound. */
+	struct FClusterCell
+	{
+		FIntVector Cell;
+		uint32 ClusterId;
+		USoundBase* Sound;
+
+		// Leader request in FlushingRequests while FlushIndex is the current flush
+		int32 LeaderIndex;
+		int32 FlushIndex;
+
+		float IntensitySquared;
+
+		// Audio time the leader's voice started, later requests are absorbed into it within the window
+		float EmitTime;
+	};
+
+	void ClusterRequests(float CurrentTime);
+
+	void ScoreRequests(UWorld* World, float CurrentTime);
+
+	TArray<FPhysicalAudioVoiceRequest> PendingRequests;
+
+	// Scratch copy so requesters can safely submit while we flush
+	TArray<FPhysicalAudioVoiceRequest> FlushingRequests;
+
+	// Audio time at which each admitted voice is expected to end
+	TArray<float> ActiveVoiceEndTimes;
+
+	// Audio time of the last admitted voice per owner, for the recency score
+	TMap<TWeakObjectPtr<UObject>, float> LastVoiceTimes;
+
+	// Fixed size, allocated once, entries expire with the cluster window
+	TArray<FClusterCell> ClusterCells;
+	int32 FlushIndex;
+	int32 NumMergedLastFlush;
+
+	int32 NumAdmittedLastFlush;
+	int32 NumRejectedLastFlush;
+	int32 NumRejectedTotal;
+};
@@ -0,0 +1,114 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicalAudioCore.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstddef>
+#include <vector>
+
+using namespace PhysicalAudioCore;
+
+namespace
+{
+	/* Deterministic positions so runs compare. */
+	std::vector<float> MakeValues(std::size_t Num, float Scale)
+	{
+		std::vector<float> Values(Num);
+		for (std::size_t Index = 0; Index < Num; ++Index)
+		{
+			Values[Index] = static_cast<float>((Index * 7919u) % 1000u) * Scale;
+		}
+		return Values;
+	}
+}
+
+/* Translation filter of @range(0) bones, three floats each. */
+static void BM_FilterVelocity(benchmark::State& State)
+{
+	const int32_t NumBones = static_cast<int32_t>(State.range(0));
+	const std::vector<float> Old = MakeValues(NumBones * 3, 0.01f);
+	const std::vector<float> New = MakeValues(NumBones * 3, 0.011f);
+	std::vector<float> Filtered(NumBones * 3, 0.f);
+
+	for (auto _ : State)
+	{
+		float Total = 0.f;
+		for (int32_t Bone = 0; Bone < NumBones; ++Bone)
+		{
+			Total += FilterVelocity(&Old[Bone * 3], &New[Bone * 3], &Filtered[Bone * 3], 3, 1.f / 60.f, 10.f);
+		}
+		benchmark::DoNotOptimize(Total);
+		benchmark::ClobberMemory();
+	}
+
+	State.SetItemsProcessed(State.iterations() * NumBones);
+}
+BENCHMARK(BM_FilterVelocity)->Arg(64)->Arg(1024)->Arg(16384);
+
+/* Threshold state machine over @range(0) bones in mixed states. */
+static void BM_EvaluateThresholds(benchmark::State& State)
+{
+	const int32_t NumBones = static_cast<int32_t>(State.range(0));
+	const std::vector<float> Deltas = MakeValues(NumBones, 0.1f);
+
+	std::vector<FBoneTriggerInput> Inputs(NumBones);
+	for (int32_t Bone = 0; Bone < NumBones; ++Bone)
+	{
+		FBoneTriggerInput& Input = Inputs[Bone];
+		Input.bAboveLoop = Deltas[Bone] > 10.f;
+		Input.bAboveMedium = Deltas[Bone] > 40.f;
+		Input.bAboveHigh = Deltas[Bone] > 80.f;
+		Input.bHasLoopSound = true;
+		Input.bHasMediumSound = true;
+		Input.bHasHighSound = (Bone & 1) == 0;
+		Input.bLoopPlaying = (Bone & 2) != 0;
+		Input.InterpolatedVolume = Input.bLoopPlaying ? 0.5f : 0.f;
+		Input.TimeSinceLastTrigger = static_cast<float>(Bone % 10) * 0.1f;
+		Input.RetriggerDelay = 0.5f;
+		Input.bDirectionChanged = (Bone % 7) == 0;
+	}
+
+	for (auto _ : State)
+	{
+		int32_t Events = 0;
+		for (const FBoneTriggerInput& Input : Inputs)
+		{
+			Events += EvaluateThresholds(Input) != ETrackedBoneEvent::None;
+		}
+		benchmark::DoNotOptimize(Events);
+	}
+
+	State.SetItemsProcessed(State.iterations() * NumBones);
+}
+BENCHMARK(BM_EvaluateThresholds)->Arg(64)->Arg(1024)->Arg(16384);
+
+/* Loop volume easing plus the push decision, what a playing loop costs per update. */
+static void BM_LoopModulation(benchmark::State& State)
+{
+	const int32_t NumBones = static_cast<int32_t>(State.range(0));
+	const std::vector<float> Deltas = MakeValues(NumBones, 0.1f);
+	std::vector<float> Volumes(NumBones, 0.f);
+	std::vector<float> Pushed(NumBones, 0.f);
+
+	for (auto _ : State)
+	{
+		int32_t Pushes = 0;
+		for (int32_t Bone = 0; Bone < NumBones; ++Bone)
+		{
+			const float Previous = Volumes[Bone];
+			Volumes[Bone] = InterpolateLoopVolume(Previous, Deltas[Bone], 10.f, 80.f, 1.f / 60.f, 4.f);
+
+			if (ShouldPushLoopParameter(Volumes[Bone], Previous, Pushed[Bone], 0.01f, 1.f, 1.f / 30.f))
+			{
+				Pushed[Bone] = Volumes[Bone];
+				++Pushes;
+			}
+		}
+		benchmark::DoNotOptimize(Pushes);
+		benchmark::ClobberMemory();
+	}
+
+	State.SetItemsProcessed(State.iterations() * NumBones);
+}
+BENCHMARK(BM_LoopModulation)->Arg(64)->Arg(1024)->Arg(16384);
@@ -0,0 +1,4 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+// Compiles the core header on its own at the strictest standard and warning level it has to support.
+#include "PhysicalAudioCore.h"
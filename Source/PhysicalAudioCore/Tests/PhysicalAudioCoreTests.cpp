@@ -0,0 +1,343 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "PhysicalAudioCore.h"
+
+#include <gtest/gtest.h>
+
+#include <limits>
+
+using namespace PhysicalAudioCore;
+
+namespace
+{
+	/* Loop playing quietly under every threshold, retrigger delay still running. */
+	FBoneTriggerInput MakeIdleInput()
+	{
+		FBoneTriggerInput Input;
+		Input.bAboveLoop = false;
+		Input.bAboveMedium = false;
+		Input.bAboveHigh = false;
+		Input.bHasLoopSound = true;
+		Input.bHasMediumSound = true;
+		Input.bHasHighSound = true;
+		Input.bLoopPlaying = false;
+		Input.InterpolatedVolume = 0.f;
+		Input.TimeSinceLastTrigger = 0.f;
+		Input.RetriggerDelay = 0.5f;
+		Input.bDirectionChanged = false;
+		return Input;
+	}
+
+	FImpactGate MakeGate()
+	{
+		FImpactGate Gate;
+		Gate.ImpulseThresholdMin = 100.f;
+		Gate.RetriggerCooldown = 0.2f;
+		Gate.LastTriggerTime = 1.f;
+		Gate.bSkipDeltaThreshold = false;
+		return Gate;
+	}
+}
+
+TEST(MapRangeClamped, RemapsAndClamps)
+{
+	EXPECT_FLOAT_EQ(MapRangeClamped(15.f, 10.f, 20.f), 0.5f);
+	EXPECT_FLOAT_EQ(MapRangeClamped(5.f, 10.f, 20.f), 0.f);
+	EXPECT_FLOAT_EQ(MapRangeClamped(25.f, 10.f, 20.f), 1.f);
+}
+
+TEST(FilterVelocity, BlendsTowardsVelocityAndReturnsDeltaSize)
+{
+	const float Old[3] = { 0.f, 0.f, 0.f };
+	const float New[3] = { 3.f, 0.f, 4.f };
+	float Filtered[3] = { 0.f, 0.f, 0.f };
+
+	// Velocity (30, 0, 40), blend 0.1 * 5
+	const float Size = FilterVelocity(Old, New, Filtered, 3, 0.1f, 5.f);
+
+	EXPECT_FLOAT_EQ(Size, 50.f);
+	EXPECT_FLOAT_EQ(Filtered[0], 15.f);
+	EXPECT_FLOAT_EQ(Filtered[1], 0.f);
+	EXPECT_FLOAT_EQ(Filtered[2], 20.f);
+}
+
+TEST(FilterVelocity, DeltaIsMeasuredAgainstFilteredValue)
+{
+	const float Old[4] = { 0.f, 0.f, 0.f, 0.f };
+	const float New[4] = { 1.f, 1.f, 1.f, 1.f };
+	float Filtered[4] = { 10.f, 10.f, 10.f, 10.f };
+
+	// Already filtered to the velocity, nothing moves
+	const float Size = FilterVelocity(Old, New, Filtered, 4, 0.1f, 5.f);
+
+	EXPECT_FLOAT_EQ(Size, 0.f);
+	EXPECT_FLOAT_EQ(Filtered[0], 10.f);
+	EXPECT_FLOAT_EQ(Filtered[3], 10.f);
+}
+
+TEST(FilterVelocity, FullBlendSnapsToVelocity)
+{
+	const float Old[3] = { 1.f, 2.f, 3.f };
+	const float New[3] = { 2.f, 2.f, 1.f };
+	float Filtered[3] = { 7.f, -7.f, 7.f };
+
+	FilterVelocity(Old, New, Filtered, 3, 0.5f, 2.f);
+
+	EXPECT_FLOAT_EQ(Filtered[0], 2.f);
+	EXPECT_FLOAT_EQ(Filtered[1], 0.f);
+	EXPECT_FLOAT_EQ(Filtered[2], -4.f);
+}
+
+TEST(FilterMeasuredVelocity, MatchesFilterVelocityOnTheSameVelocity)
+{
+	const float Old[3] = { 0.f, 0.f, 0.f };
+	const float New[3] = { 0.5f, -1.f, 2.f };
+	const float Velocity[3] = { 5.f, -10.f, 20.f };
+
+	float FromPositions[3] = { 1.f, 2.f, 3.f };
+	float FromVelocity[3] = { 1.f, 2.f, 3.f };
+
+	const float SizeFromPositions = FilterVelocity(Old, New, FromPositions, 3, 0.1f, 3.f);
+	const float SizeFromVelocity = FilterMeasuredVelocity(Velocity, FromVelocity, 3, 0.1f, 3.f);
+
+	EXPECT_FLOAT_EQ(SizeFromPositions, SizeFromVelocity);
+	for (int Index = 0; Index < 3; ++Index)
+	{
+		EXPECT_FLOAT_EQ(FromPositions[Index], FromVelocity[Index]);
+	}
+}
+
+TEST(ShouldWakeOnCustomTransform, SleepingSlotWakesWhenMoved)
+{
+	const float Location[3] = { 10.f, 20.f, 30.f };
+	const float Rotation[4] = { 0.f, 0.f, 0.f, 1.f };
+
+	const float Moved[3] = { 10.f, 20.f, 31.f };
+	EXPECT_TRUE(ShouldWakeOnCustomTransform(true, Location, Rotation, Moved, Rotation, 1.e-4f));
+
+	// Quarter turn around Z
+	const float Rotated[4] = { 0.f, 0.f, 0.7071068f, 0.7071068f };
+	EXPECT_TRUE(ShouldWakeOnCustomTransform(true, Location, Rotation, Location, Rotated, 1.e-4f));
+}
+
+TEST(ShouldWakeOnCustomTransform, StillSlotStaysAsleep)
+{
+	const float Location[3] = { 10.f, 20.f, 30.f };
+	const float Rotation[4] = { 0.f, 0.f, 0.7071068f, 0.7071068f };
+	EXPECT_FALSE(ShouldWakeOnCustomTransform(true, Location, Rotation, Location, Rotation, 1.e-4f));
+
+	// Under the tolerance
+	const float Nudged[3] = { 10.f, 20.f, 30.00005f };
+	EXPECT_FALSE(ShouldWakeOnCustomTransform(true, Location, Rotation, Nudged, Rotation, 1.e-4f));
+
+	// Same rotation, other sign
+	const float Negated[4] = { -0.f, -0.f, -0.7071068f, -0.7071068f };
+	EXPECT_FALSE(ShouldWakeOnCustomTransform(true, Location, Rotation, Location, Negated, 1.e-4f));
+}
+
+TEST(ShouldWakeOnCustomTransform, AwakeSlotNeverWakes)
+{
+	const float Location[3] = { 0.f, 0.f, 0.f };
+	const float Rotation[4] = { 0.f, 0.f, 0.f, 1.f };
+	const float Moved[3] = { 100.f, 0.f, 0.f };
+	EXPECT_FALSE(ShouldWakeOnCustomTransform(false, Location, Rotation, Moved, Rotation, 1.e-4f));
+}
+
+TEST(EvaluateThresholds, IdleIsNone)
+{
+	EXPECT_EQ(EvaluateThresholds(MakeIdleInput()), ETrackedBoneEvent::None);
+}
+
+TEST(EvaluateThresholds, LoopStartTakesPrecedenceOverOneShots)
+{
+	FBoneTriggerInput Input = MakeIdleInput();
+	Input.bAboveLoop = true;
+	Input.bAboveMedium = true;
+	Input.bAboveHigh = true;
+	Input.TimeSinceLastTrigger = 10.f;
+
+	EXPECT_EQ(EvaluateThresholds(Input), ETrackedBoneEvent::SlowThresholdStart);
+}
+
+TEST(EvaluateThresholds, LoopStartNeedsALoopSound)
+{
+	FBoneTriggerInput Input = MakeIdleInput();
+	Input.bAboveLoop = true;
+	Input.bHasLoopSound = false;
+
+	EXPECT_EQ(EvaluateThresholds(Input), ETrackedBoneEvent::None);
+}
+
+TEST(EvaluateThresholds, PlayingLoopDoesNotRestart)
+{
+	FBoneTriggerInput Input = MakeIdleInput();
+	Input.bAboveLoop = true;
+	Input.bLoopPlaying = true;
+	Input.InterpolatedVolume = 0.5f;
+
+	EXPECT_EQ(EvaluateThresholds(Input), ETrackedBoneEvent::LoopModulated);
+}
+
+TEST(EvaluateThresholds, LoopStopTakesPrecedenceOverOneShots)
+{
+	FBoneTriggerInput Input = MakeIdleInput();
+	Input.bLoopPlaying = true;
+	Input.bAboveMedium = true;
+	Input.TimeSinceLastTrigger = 10.f;
+
+	EXPECT_EQ(EvaluateThresholds(Input), ETrackedBoneEvent::SlowThresholdStop);
+}
+
+TEST(EvaluateThresholds, LoopFadesOutBeforeStopping)
+{
+	FBoneTriggerInput Input = MakeIdleInput();
+	Input.bLoopPlaying = true;
+	Input.InterpolatedVolume = 1.e-3f;
+
+	EXPECT_EQ(EvaluateThresholds(Input), ETrackedBoneEvent::LoopModulated);
+}
+
+TEST(EvaluateThresholds, RetriggerDelayBlocksOneShots)
+{
+	FBoneTriggerInput Input = MakeIdleInput();
+	Input.bAboveMedium = true;
+	Input.TimeSinceLastTrigger = 0.49f;
+
+	EXPECT_EQ(EvaluateThresholds(Input), ETrackedBoneEvent::None);
+
+	Input.TimeSinceLastTrigger = 0.5f;
+	EXPECT_EQ(EvaluateThresholds(Input), ETrackedBoneEvent::MediumThreshold);
+}
+
+TEST(EvaluateThresholds, DirectionChangeBypassesRetriggerDelay)
+{
+	FBoneTriggerInput Input = MakeIdleInput();
+	Input.bAboveMedium = true;
+	Input.bAboveHigh = true;
+	Input.bDirectionChanged = true;
+
+	EXPECT_EQ(EvaluateThresholds(Input), ETrackedBoneEvent::FastThreshold);
+}
+
+TEST(EvaluateThresholds, HighThresholdPlaysFastNotMedium)
+{
+	FBoneTriggerInput Input = MakeIdleInput();
+	Input.bAboveMedium = true;
+	Input.bAboveHigh = true;
+	Input.TimeSinceLastTrigger = 10.f;
+
+	EXPECT_EQ(EvaluateThresholds(Input), ETrackedBoneEvent::FastThreshold);
+
+	Input.bHasHighSound = false;
+	EXPECT_EQ(EvaluateThresholds(Input), ETrackedBoneEvent::None);
+}
+
+TEST(EvaluateThresholds, MissingMediumSoundIsNone)
+{
+	FBoneTriggerInput Input = MakeIdleInput();
+	Input.bAboveMedium = true;
+	Input.bHasMediumSound = false;
+	Input.TimeSinceLastTrigger = 10.f;
+
+	EXPECT_EQ(EvaluateThresholds(Input), ETrackedBoneEvent::None);
+}
+
+TEST(RestartsRetriggerDelay, OnlyOneShots)
+{
+	EXPECT_TRUE(RestartsRetriggerDelay(ETrackedBoneEvent::MediumThreshold));
+	EXPECT_TRUE(RestartsRetriggerDelay(ETrackedBoneEvent::FastThreshold));
+	EXPECT_FALSE(RestartsRetriggerDelay(ETrackedBoneEvent::SlowThresholdStart));
+	EXPECT_FALSE(RestartsRetriggerDelay(ETrackedBoneEvent::SlowThresholdStop));
+	EXPECT_FALSE(RestartsRetriggerDelay(ETrackedBoneEvent::LoopModulated));
+	EXPECT_FALSE(RestartsRetriggerDelay(ETrackedBoneEvent::None));
+}
+
+TEST(InterpolateLoopVolume, EasesTowardsMappedDelta)
+{
+	// Target 0.5, blend 0.25
+	EXPECT_FLOAT_EQ(InterpolateLoopVolume(0.f, 15.f, 10.f, 20.f, 0.05f, 5.f), 0.125f);
+	EXPECT_FLOAT_EQ(InterpolateLoopVolume(1.f, 15.f, 10.f, 20.f, 0.05f, 5.f), 0.875f);
+}
+
+TEST(InterpolateLoopVolume, TargetIsClamped)
+{
+	EXPECT_FLOAT_EQ(InterpolateLoopVolume(0.5f, 100.f, 10.f, 20.f, 0.1f, 10.f), 1.f);
+	EXPECT_FLOAT_EQ(InterpolateLoopVolume(0.5f, -100.f, 10.f, 20.f, 0.1f, 10.f), 0.f);
+}
+
+TEST(InterpolateLoopVolume, ConvergesAndReachesStopVolume)
+{
+	float Volume = 1.f;
+	for (int Step = 0; Step < 2000; ++Step)
+	{
+		Volume = InterpolateLoopVolume(Volume, 0.f, 10.f, 20.f, 1.f / 60.f, 6.f);
+	}
+
+	EXPECT_LE(Volume, 1.e-8f);
+}
+
+TEST(ShouldPushLoopParameter, IgnoresNegligibleChanges)
+{
+	EXPECT_FALSE(ShouldPushLoopParameter(0.50005f, 0.50005f, 0.5f, 0.01f, 1.f, 0.f));
+}
+
+TEST(ShouldPushLoopParameter, WaitsForMinInterval)
+{
+	EXPECT_FALSE(ShouldPushLoopParameter(0.9f, 0.8f, 0.5f, 0.01f, 0.01f, 1.f / 30.f));
+	EXPECT_TRUE(ShouldPushLoopParameter(0.9f, 0.8f, 0.5f, 0.01f, 1.f / 30.f, 1.f / 30.f));
+}
+
+TEST(ShouldPushLoopParameter, PushesChangesOverDeadband)
+{
+	EXPECT_TRUE(ShouldPushLoopParameter(0.52f, 0.51f, 0.5f, 0.01f, 1.f, 0.f));
+}
+
+TEST(ShouldPushLoopParameter, SmallChangeWaitsUntilSettled)
+{
+	// Still moving by more than a tenth of the deadband
+	EXPECT_FALSE(ShouldPushLoopParameter(0.505f, 0.503f, 0.5f, 0.01f, 1.f, 0.f));
+
+	// Settled, snap to it
+	EXPECT_TRUE(ShouldPushLoopParameter(0.505f, 0.5049f, 0.5f, 0.01f, 1.f, 0.f));
+}
+
+TEST(ValidateImpact, AcceptsValidHit)
+{
+	EXPECT_EQ(ValidateImpact(MakeGate(), 150.f, 2.f, [] { return true; }), EImpactRejection::None);
+}
+
+TEST(ValidateImpact, ImpulseIsCheckedFirst)
+{
+	bool bAskedHasMoved = false;
+	const auto HasMoved = [&bAskedHasMoved] { bAskedHasMoved = true; return false; };
+
+	// Also inside the cooldown and not moved
+	EXPECT_EQ(ValidateImpact(MakeGate(), 50.f, 1.1f, HasMoved), EImpactRejection::Impulse);
+	EXPECT_EQ(ValidateImpact(MakeGate(), 100.f, 2.f, HasMoved), EImpactRejection::Impulse);
+	EXPECT_EQ(ValidateImpact(MakeGate(), std::numeric_limits<float>::quiet_NaN(), 2.f, HasMoved), EImpactRejection::Impulse);
+	EXPECT_FALSE(bAskedHasMoved);
+}
+
+TEST(ValidateImpact, CooldownIsCheckedBeforeDelta)
+{
+	bool bAskedHasMoved = false;
+	const auto HasMoved = [&bAskedHasMoved] { bAskedHasMoved = true; return false; };
+
+	EXPECT_EQ(ValidateImpact(MakeGate(), 150.f, 1.1f, HasMoved), EImpactRejection::Cooldown);
+	EXPECT_FALSE(bAskedHasMoved);
+
+	EXPECT_EQ(ValidateImpact(MakeGate(), 150.f, 1.3f, HasMoved), EImpactRejection::DeltaThreshold);
+	EXPECT_TRUE(bAskedHasMoved);
+}
+
+TEST(ValidateImpact, SkippedDeltaThresholdNeverAsksHasMoved)
+{
+	FImpactGate Gate = MakeGate();
+	Gate.bSkipDeltaThreshold = true;
+
+	bool bAskedHasMoved = false;
+	const auto HasMoved = [&bAskedHasMoved] { bAskedHasMoved = true; return false; };
+
+	EXPECT_EQ(ValidateImpact(Gate, 150.f, 2.f, HasMoved), EImpactRejection::None);
+	EXPECT_FALSE(bAskedHasMoved);
+}